@@ -38,6 +38,8 @@
 
 namespace ledger {
 
+std::size_t account_t::next_id = 0;
+
 account_t::~account_t()
 {
   TRACE_DTOR(account_t);
@@ -46,47 +48,60 @@ account_t::~account_t()
     checked_delete(pair.second);
 }
 
-account_t * account_t::find_account(const string& name,
-				    const bool	  auto_create)
+bool account_t::remove_account(account_t * acct)
 {
-  accounts_map::const_iterator i = accounts.find(name);
-  if (i != accounts.end())
-    return (*i).second;
-
-  char buf[256];
-
-  string::size_type sep = name.find(':');
-  assert(sep < 256|| sep == string::npos);
+  accounts_map::size_type n = accounts.erase(acct->name);
 
-  const char * first, * rest;
-  if (sep == string::npos) {
-    first = name.c_str();
-    rest  = NULL;
-  } else {
-    std::strncpy(buf, name.c_str(), sep);
-    buf[sep] = '\0';
+  // Any path remembered here or further up may lead to the account
+  // removed, or to one beneath it.
+  for (account_t * account = this; account; account = account->parent)
+    account->account_paths.clear();
 
-    first = buf;
-    rest  = name.c_str() + sep + 1;
-  }
+  return n > 0;
+}
 
-  account_t * account;
+account_t * account_t::find_account(const string& name,
+				    const bool	  auto_create)
+{
+  account_paths_map::const_iterator p = account_paths.find(name);
+  if (p != account_paths.end())
+    return (*p).second;
+
+  account_t *	    account = this;
+  string::size_type beg	    = 0;
+
+  while (true) {
+    accounts_map::const_iterator i =
+      account->accounts.find(beg == 0 ? name : string(name, beg));
+    if (i != account->accounts.end()) {
+      account = (*i).second;
+      break;
+    }
 
-  i = accounts.find(first);
-  if (i == accounts.end()) {
-    if (! auto_create)
-      return NULL;
+    string::size_type sep   = name.find(':', beg);
+    string	      first = (sep == string::npos ?
+			       string(name, beg) : string(name, beg, sep - beg));
+
+    i = account->accounts.find(first);
+    if (i == account->accounts.end()) {
+      if (! auto_create)
+	return NULL;
+
+      account_t * child = new account_t(account, first);
+      std::pair<accounts_map::iterator, bool> result
+	= account->accounts.insert(accounts_map::value_type(first, child));
+      assert(result.second);
+      account = child;
+    } else {
+      account = (*i).second;
+    }
 
-    account = new account_t(this, first);
-    std::pair<accounts_map::iterator, bool> result
-      = accounts.insert(accounts_map::value_type(first, account));
-    assert(result.second);
-  } else {
-    account = (*i).second;
+    if (sep == string::npos)
+      break;
+    beg = sep + 1;
   }
 
-  if (rest)
-    account = account->find_account(rest, auto_create);
+  account_paths.insert(account_paths_map::value_type(name, account));
 
   return account;
 }
@@ -110,11 +125,9 @@ account_t * account_t::find_account_re(const string& regexp)
   return find_account_re_(this, mask_t(regexp));
 }
 
-string account_t::fullname() const
+const string& account_t::fullname() const
 {
-  if (! _fullname.empty()) {
-    return _fullname;
-  } else {
+  if (_fullname.empty()) {
     const account_t *	first	 = this;
     string		fullname = name;
 
@@ -125,9 +138,8 @@ string account_t::fullname() const
     }
 
     _fullname = fullname;
-
-    return fullname;
   }
+  return _fullname;
 }
 
 string account_t::partial_name(bool flat) const
@@ -267,6 +279,12 @@ expr_t::ptr_op_t account_t::lookup(const string& name)
   return NULL;
 }
 
+dispatch_table_t * account_t::dispatch_table()
+{
+  static dispatch_table_t table;
+  return &table;
+}
+
 bool account_t::valid() const
 {
   if (depth > 256) {
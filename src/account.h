@@ -57,6 +57,7 @@ class post_t;
 
 typedef std::deque<post_t *>                posts_deque;
 typedef std::map<const string, account_t *> accounts_map;
+typedef boost::unordered_map<string, account_t *> account_paths_map;
 
 /**
  * @brief Brief
@@ -77,12 +78,22 @@ class account_t : public scope_t
   mutable void *   data;
   mutable string   _fullname;
 
+  // Every account is numbered as it is created, so that facts about
+  // accounts can be kept in tables indexed by this number.
+  std::size_t	   id;
+
+  static std::size_t next_id;
+
+  // Accounts already found beneath this one, by their path relative to
+  // it, so that looking one up again need not walk the tree.
+  account_paths_map account_paths;
+
   account_t(account_t *             _parent = NULL,
 	    const string&           _name   = "",
 	    const optional<string>& _note   = none)
     : scope_t(), parent(_parent), name(_name), note(_note),
       depth(static_cast<unsigned short>(parent ? parent->depth + 1 : 0)),
-      known(false), data(NULL) {
+      known(false), data(NULL), id(next_id++) {
     TRACE_CTOR(account_t, "account_t *, const string&, const string&");
   }
   account_t(const account_t& other)
@@ -93,7 +104,8 @@ class account_t : public scope_t
       depth(other.depth),
       accounts(other.accounts),
       known(other.known),
-      data(NULL) {
+      data(NULL),
+      id(next_id++) {
     TRACE_CTOR(account_t, "copy");
     assert(other.data == NULL);
   }
@@ -102,16 +114,13 @@ class account_t : public scope_t
   operator string() const {
     return fullname();
   }
-  string fullname() const;
+  const string& fullname() const;
   string partial_name(bool flat = false) const;
 
   void add_account(account_t * acct) {
     accounts.insert(accounts_map::value_type(acct->name, acct));
   }
-  bool remove_account(account_t * acct) {
-    accounts_map::size_type n = accounts.erase(acct->name);
-    return n > 0;
-  }
+  bool remove_account(account_t * acct);
 
   account_t * find_account(const string& name, bool auto_create = true);
   account_t * find_account_re(const string& regexp);
@@ -121,6 +130,7 @@ class account_t : public scope_t
   }
 
   virtual expr_t::ptr_op_t lookup(const string& name);
+  virtual dispatch_table_t * dispatch_table();
 
   bool valid() const;
 
@@ -47,28 +47,110 @@ static mpfr_t tempf;
 static mpfr_t tempfb;
 #endif
 
+namespace {
+  // Most amounts in a journal are decimals with only a few digits, such as
+  // $12.34.  These are kept as a 64-bit integer scaled by a power of ten,
+  // and added, subtracted, multiplied and compared as such, with GMP only
+  // called upon once a result will not fit, or the rational number itself
+  // is needed.
+  const amount_t::precision_t max_fixed_scale = 18;
+
+  const int64_t max_fixed = std::numeric_limits<int64_t>::max();
+  const int64_t min_fixed = std::numeric_limits<int64_t>::min();
+
+  bool fixed_scale_up(int64_t& value, int digits)
+  {
+    for (; digits > 0; digits--) {
+      if (value > max_fixed / 10 || value < min_fixed / 10)
+	return false;
+      value *= 10;
+    }
+    return true;
+  }
+
+  bool fixed_add(int64_t& result, int64_t left, int64_t right)
+  {
+    if ((right > 0 && left > max_fixed - right) ||
+	(right < 0 && left < min_fixed - right))
+      return false;
+    result = left + right;
+    return true;
+  }
+
+  bool fixed_multiply(int64_t& result, int64_t left, int64_t right)
+  {
+    if (left == min_fixed || right == min_fixed)
+      return false;
+    int64_t abs_left  = left  < 0 ? -left  : left;
+    int64_t abs_right = right < 0 ? -right : right;
+    if (abs_right != 0 && abs_left > max_fixed / abs_right)
+      return false;
+    result = left * right;
+    return true;
+  }
+
+  // Bring two fixed values to the larger of their scales.
+  bool fixed_align(int64_t& left,  amount_t::precision_t left_scale,
+		   int64_t& right, amount_t::precision_t right_scale,
+		   amount_t::precision_t& scale)
+  {
+    if (left_scale < right_scale) {
+      scale = right_scale;
+      return fixed_scale_up(left, right_scale - left_scale);
+    } else {
+      scale = left_scale;
+      return fixed_scale_up(right, left_scale - right_scale);
+    }
+  }
+
+  void mpz_set_fixed(mpz_ptr z, int64_t value)
+  {
+    if (value >= std::numeric_limits<long>::min() &&
+	value <= std::numeric_limits<long>::max()) {
+      mpz_set_si(z, static_cast<long>(value));
+    } else {
+      bool     negative  = value < 0;
+      uint64_t magnitude = (negative ? uint64_t(0) - uint64_t(value) :
+			    uint64_t(value));
+      mpz_set_ui(z, static_cast<unsigned long>(magnitude >> 32));
+      mpz_mul_2exp(z, z, 32);
+      mpz_add_ui(z, z, static_cast<unsigned long>(magnitude & 0xffffffffUL));
+      if (negative)
+	mpz_neg(z, z);
+    }
+  }
+}
+
 struct amount_t::bigint_t : public supports_flags<>
 {
 #define BIGINT_BULK_ALLOC 0x01
 #define BIGINT_KEEP_PREC  0x02
+#define BIGINT_FIXED      0x04	// `fixed' holds the value exactly
+#define BIGINT_STALE      0x08	// `val' is not yet set from `fixed'
 
   mpq_t		 val;
+  int64_t	 fixed;		// the value, times 10^scale
+  precision_t	 scale;
   precision_t	 prec;
   uint_least16_t ref;
 
-#define MP(bigint) ((bigint)->val)
+  // MP gives the rational value for changing it, after which `fixed' no
+  // longer applies; MP_CONST gives it only for reading.
+#define MP(bigint)	 ((bigint)->mpq())
+#define MP_CONST(bigint) ((bigint)->const_mpq())
 
-  bigint_t() : prec(0), ref(1) {
+  bigint_t() : fixed(0), scale(0), prec(0), ref(1) {
     TRACE_CTOR(bigint_t, "");
     mpq_init(val);
   }
   bigint_t(const bigint_t& other)
     : supports_flags<>(static_cast<uint_least8_t>
 		       (other.flags() & ~BIGINT_BULK_ALLOC)),
-      prec(other.prec), ref(1) {
+      fixed(other.fixed), scale(other.scale), prec(other.prec), ref(1) {
     TRACE_CTOR(bigint_t, "copy");
     mpq_init(val);
-    mpq_set(val, other.val);
+    if (! other.has_flags(BIGINT_STALE))
+      mpq_set(val, other.val);
   }
   ~bigint_t() {
     TRACE_DTOR(bigint_t);
@@ -76,6 +158,89 @@ struct amount_t::bigint_t : public supports_flags<>
     mpq_clear(val);
   }
 
+  // Quantities no longer referred to are kept for reuse rather than
+  // deleted, since amounts are made and discarded in great numbers.  Their
+  // mpq_t stays initialized, so that its limbs are reused as well.
+  static std::vector<bigint_t *> free_list;
+
+  static std::size_t allocated;
+  static std::size_t reused;
+  static std::size_t live;
+  static std::size_t peak_live;
+
+  static bigint_t * create() {
+    bigint_t * q;
+    if (free_list.empty()) {
+      q = new bigint_t;
+      allocated++;
+    } else {
+      q = free_list.back();
+      free_list.pop_back();
+      q->set_flags(0);
+      mpq_set_ui(q->val, 0, 1);
+      q->fixed = 0;
+      q->scale = 0;
+      q->prec  = 0;
+      q->ref   = 1;
+      reused++;
+    }
+    if (++live > peak_live)
+      peak_live = live;
+    return q;
+  }
+  static bigint_t * create(const bigint_t& other) {
+    if (free_list.empty()) {
+      allocated++;
+      if (++live > peak_live)
+	peak_live = live;
+      return new bigint_t(other);
+    }
+
+    bigint_t * q = create();
+    q->set_flags(static_cast<uint_least8_t>
+		 (other.flags() & ~BIGINT_BULK_ALLOC));
+    if (! other.has_flags(BIGINT_STALE))
+      mpq_set(q->val, other.val);
+    q->fixed = other.fixed;
+    q->scale = other.scale;
+    q->prec  = other.prec;
+    return q;
+  }
+  static void destroy(bigint_t * q) {
+    assert(q->ref == 0);
+    live--;
+    if (q->has_flags(BIGINT_BULK_ALLOC))
+      q->~bigint_t();
+    else
+      free_list.push_back(q);
+  }
+  static void release_free_list() {
+    foreach (bigint_t * q, free_list)
+      checked_delete(q);
+    free_list.clear();
+  }
+
+  void set_fixed(int64_t value, precision_t value_scale) {
+    fixed = value;
+    scale = value_scale;
+    add_flags(BIGINT_FIXED | BIGINT_STALE);
+  }
+
+  mpq_srcptr const_mpq() {
+    if (has_flags(BIGINT_STALE)) {
+      mpz_set_fixed(mpq_numref(val), fixed);
+      mpz_ui_pow_ui(mpq_denref(val), 10, scale);
+      mpq_canonicalize(val);
+      drop_flags(BIGINT_STALE);
+    }
+    return val;
+  }
+  mpq_ptr mpq() {
+    const_mpq();
+    drop_flags(BIGINT_FIXED);
+    return val;
+  }
+
   bool valid() const {
     if (prec > 1024) {
       DEBUG("ledger.validate", "amount_t::bigint_t: prec > 128");
@@ -85,15 +250,31 @@ struct amount_t::bigint_t : public supports_flags<>
       DEBUG("ledger.validate", "amount_t::bigint_t: ref > 16535");
       return false;
     }
-    if (flags() & ~(BIGINT_BULK_ALLOC | BIGINT_KEEP_PREC)) {
+    if (flags() & ~(BIGINT_BULK_ALLOC | BIGINT_KEEP_PREC |
+		    BIGINT_FIXED | BIGINT_STALE)) {
       DEBUG("ledger.validate",
-	    "amount_t::bigint_t: flags() & ~(BULK_ALLOC | KEEP_PREC)");
+	    "amount_t::bigint_t: flags() & ~(BULK_ALLOC | KEEP_PREC | FIXED | STALE)");
+      return false;
+    }
+    if (has_flags(BIGINT_STALE) && ! has_flags(BIGINT_FIXED)) {
+      DEBUG("ledger.validate", "amount_t::bigint_t: STALE without FIXED");
+      return false;
+    }
+    if (has_flags(BIGINT_FIXED) && scale > max_fixed_scale) {
+      DEBUG("ledger.validate", "amount_t::bigint_t: scale > max_fixed_scale");
       return false;
     }
     return true;
   }
 };
 
+std::vector<amount_t::bigint_t *> amount_t::bigint_t::free_list;
+
+std::size_t amount_t::bigint_t::allocated = 0;
+std::size_t amount_t::bigint_t::reused	  = 0;
+std::size_t amount_t::bigint_t::live	  = 0;
+std::size_t amount_t::bigint_t::peak_live = 0;
+
 shared_ptr<commodity_pool_t> amount_t::current_pool;
 
 bool amount_t::is_initialized = false;
@@ -118,6 +299,7 @@ void amount_t::initialize()
 void amount_t::shutdown()
 {
   current_pool.reset();
+  bigint_t::release_free_list();
 
   if (is_initialized) {
     mpz_clear(temp);
@@ -139,7 +321,7 @@ void amount_t::_copy(const amount_t& amt)
     // Never maintain a pointer into a bulk allocation pool; such
     // pointers are not guaranteed to remain.
     if (amt.quantity->has_flags(BIGINT_BULK_ALLOC)) {
-      quantity = new bigint_t(*amt.quantity);
+      quantity = bigint_t::create(*amt.quantity);
     } else {
       quantity = amt.quantity;
       DEBUG("amounts.refs",
@@ -157,7 +339,7 @@ void amount_t::_dup()
   VERIFY(valid());
 
   if (quantity->ref > 1) {
-    bigint_t * q = new bigint_t(*quantity);
+    bigint_t * q = bigint_t::create(*quantity);
     _release();
     quantity = q;
   }
@@ -183,10 +365,7 @@ void amount_t::_release()
   DEBUG("amounts.refs", quantity << " ref--, now " << (quantity->ref - 1));
 
   if (--quantity->ref == 0) {
-    if (quantity->has_flags(BIGINT_BULK_ALLOC))
-      quantity->~bigint_t();
-    else
-      checked_delete(quantity);
+    bigint_t::destroy(quantity);
     quantity   = NULL;
     commodity_ = NULL;
   }
@@ -198,7 +377,7 @@ void amount_t::_release()
 amount_t::amount_t(const double val) : commodity_(NULL)
 {
   TRACE_CTOR(amount_t, "const double");
-  quantity = new bigint_t;
+  quantity = bigint_t::create();
   mpq_set_d(MP(quantity), val);
   quantity->prec = extend_by_digits; // an approximation
 }
@@ -206,18 +385,28 @@ amount_t::amount_t(const double val) : commodity_(NULL)
 amount_t::amount_t(const unsigned long val) : commodity_(NULL)
 {
   TRACE_CTOR(amount_t, "const unsigned long");
-  quantity = new bigint_t;
-  mpq_set_ui(MP(quantity), val, 1);
+  quantity = bigint_t::create();
+  if (val <= static_cast<unsigned long>(max_fixed))
+    quantity->set_fixed(static_cast<int64_t>(val), 0);
+  else
+    mpq_set_ui(MP(quantity), val, 1);
 }
 
 amount_t::amount_t(const long val) : commodity_(NULL)
 {
   TRACE_CTOR(amount_t, "const long");
-  quantity = new bigint_t;
-  mpq_set_si(MP(quantity), val, 1);
+  quantity = bigint_t::create();
+  quantity->set_fixed(val, 0);
 }
 
 
+void amount_t::log_statistics()
+{
+  INFO("Amount quantities: " << bigint_t::allocated << " allocated, "
+       << bigint_t::reused << " reused, "
+       << bigint_t::peak_live << " in use at most");
+}
+
 amount_t& amount_t::operator=(const amount_t& amt)
 {
   if (this != &amt) {
@@ -249,7 +438,16 @@ int amount_t::compare(const amount_t& amt) const
 	   _("Cannot compare amounts with different commodities: %1 and %2")
 	   << commodity().symbol() << amt.commodity().symbol());
 
-  return mpq_cmp(MP(quantity), MP(amt.quantity));
+  if (quantity->has_flags(BIGINT_FIXED) &&
+      amt.quantity->has_flags(BIGINT_FIXED)) {
+    int64_t	left  = quantity->fixed;
+    int64_t	right = amt.quantity->fixed;
+    precision_t scale;
+    if (fixed_align(left, quantity->scale, right, amt.quantity->scale, scale))
+      return left < right ? -1 : (left > right ? 1 : 0);
+  }
+
+  return mpq_cmp(MP_CONST(quantity), MP_CONST(amt.quantity));
 }
 
 bool amount_t::operator==(const amount_t& amt) const
@@ -261,7 +459,42 @@ bool amount_t::operator==(const amount_t& amt) const
   else if (commodity() != amt.commodity())
     return false;
 
-  return mpq_equal(MP(quantity), MP(amt.quantity));
+  if (quantity->has_flags(BIGINT_FIXED) &&
+      amt.quantity->has_flags(BIGINT_FIXED)) {
+    int64_t	left  = quantity->fixed;
+    int64_t	right = amt.quantity->fixed;
+    precision_t scale;
+    if (fixed_align(left, quantity->scale, right, amt.quantity->scale, scale))
+      return left == right;
+  }
+
+  return mpq_equal(MP_CONST(quantity), MP_CONST(amt.quantity));
+}
+
+namespace {
+  void hash_mpz(std::size_t& seed, mpz_srcptr z)
+  {
+    boost::hash_combine(seed, mpz_sgn(z));
+    for (std::size_t i = 0, size = mpz_size(z); i < size; i++)
+      boost::hash_combine(seed, mpz_getlimbn(z, i));
+  }
+}
+
+std::size_t amount_t::hash() const
+{
+  std::size_t seed = 0;
+  if (quantity) {
+    // The rational form is canonical, whereas the same value may be held
+    // in fixed-point form at several different scales.
+    mpq_srcptr val = MP_CONST(quantity);
+    hash_mpz(seed, mpq_numref(val));
+    hash_mpz(seed, mpq_denref(val));
+
+    // Annotated commodities compare equal by their details, so only the
+    // commodity they annotate is used here.
+    boost::hash_combine(seed, &commodity().referent());
+  }
+  return seed;
 }
 
 
@@ -287,7 +520,17 @@ amount_t& amount_t::operator+=(const amount_t& amt)
 
   _dup();
 
-  mpq_add(MP(quantity), MP(quantity), MP(amt.quantity));
+  int64_t     left, right, sum;
+  precision_t scale;
+  if (quantity->has_flags(BIGINT_FIXED) &&
+      amt.quantity->has_flags(BIGINT_FIXED) &&
+      (left = quantity->fixed, right = amt.quantity->fixed,
+       fixed_align(left, quantity->scale, right, amt.quantity->scale,
+		   scale)) &&
+      fixed_add(sum, left, right))
+    quantity->set_fixed(sum, scale);
+  else
+    mpq_add(MP(quantity), MP(quantity), MP_CONST(amt.quantity));
 
   if (has_commodity() == amt.has_commodity())
     if (quantity->prec < amt.quantity->prec)
@@ -318,7 +561,18 @@ amount_t& amount_t::operator-=(const amount_t& amt)
 
   _dup();
 
-  mpq_sub(MP(quantity), MP(quantity), MP(amt.quantity));
+  int64_t     left, right, difference;
+  precision_t scale;
+  if (quantity->has_flags(BIGINT_FIXED) &&
+      amt.quantity->has_flags(BIGINT_FIXED) &&
+      amt.quantity->fixed != min_fixed &&
+      (left = quantity->fixed, right = amt.quantity->fixed,
+       fixed_align(left, quantity->scale, right, amt.quantity->scale,
+		   scale)) &&
+      fixed_add(difference, left, -right))
+    quantity->set_fixed(difference, scale);
+  else
+    mpq_sub(MP(quantity), MP(quantity), MP_CONST(amt.quantity));
 
   if (has_commodity() == amt.has_commodity())
     if (quantity->prec < amt.quantity->prec)
@@ -342,7 +596,15 @@ amount_t& amount_t::operator*=(const amount_t& amt)
 
   _dup();
 
-  mpq_mul(MP(quantity), MP(quantity), MP(amt.quantity));
+  int64_t product;
+  if (quantity->has_flags(BIGINT_FIXED) &&
+      amt.quantity->has_flags(BIGINT_FIXED) &&
+      quantity->scale + amt.quantity->scale <= max_fixed_scale &&
+      fixed_multiply(product, quantity->fixed, amt.quantity->fixed))
+    quantity->set_fixed(product, static_cast<precision_t>
+			(quantity->scale + amt.quantity->scale));
+  else
+    mpq_mul(MP(quantity), MP(quantity), MP_CONST(amt.quantity));
   quantity->prec = static_cast<precision_t>(quantity->prec +
 					    amt.quantity->prec);
 
@@ -379,7 +641,7 @@ amount_t& amount_t::operator/=(const amount_t& amt)
   // Increase the value's precision, to capture fractional parts after
   // the divide.  Round up in the last position.
 
-  mpq_div(MP(quantity), MP(quantity), MP(amt.quantity));
+  mpq_div(MP(quantity), MP(quantity), MP_CONST(amt.quantity));
   quantity->prec =
     static_cast<precision_t>(quantity->prec + amt.quantity->prec +
 			     quantity->prec + extend_by_digits);
@@ -451,7 +713,10 @@ void amount_t::in_place_negate()
 {
   if (quantity) {
     _dup();
-    mpq_neg(MP(quantity), MP(quantity));
+    if (quantity->has_flags(BIGINT_FIXED) && quantity->fixed != min_fixed)
+      quantity->set_fixed(- quantity->fixed, quantity->scale);
+    else
+      mpq_neg(MP(quantity), MP(quantity));
   } else {
     throw_(amount_error, _("Cannot negate an uninitialized amount"));
   }
@@ -568,12 +833,15 @@ int amount_t::sign() const
   if (! quantity)
     throw_(amount_error, _("Cannot determine sign of an uninitialized amount"));
 
-  return mpq_sgn(MP(quantity));
+  if (quantity->has_flags(BIGINT_FIXED))
+    return quantity->fixed < 0 ? -1 : (quantity->fixed > 0 ? 1 : 0);
+
+  return mpq_sgn(MP_CONST(quantity));
 }
 
 namespace {
   void stream_out_mpq(std::ostream&	            out,
-		      mpq_t		            quant,
+		      mpq_srcptr	            quant,
 		      amount_t::precision_t         prec,
 		      int                           zeros_prec = -1,
 		      const optional<commodity_t&>& comm       = none)
@@ -674,8 +942,8 @@ bool amount_t::is_zero() const
     else if (is_realzero()) {
       return true;
     }
-    else if (mpz_cmp(mpq_numref(MP(quantity)),
-		     mpq_denref(MP(quantity))) > 0) {
+    else if (mpz_cmp(mpq_numref(MP_CONST(quantity)),
+		     mpq_denref(MP_CONST(quantity))) > 0) {
       DEBUG("amount.is_zero", "Numerator is larger than the denominator");
       return false;
     }
@@ -683,7 +951,7 @@ bool amount_t::is_zero() const
       DEBUG("amount.is_zero", "We have to print the number to check for zero");
 
       std::ostringstream out;
-      stream_out_mpq(out, MP(quantity), commodity().precision());
+      stream_out_mpq(out, MP_CONST(quantity), commodity().precision());
 
       string output = out.str();
       if (! output.empty()) {
@@ -703,7 +971,7 @@ double amount_t::to_double() const
   if (! quantity)
     throw_(amount_error, _("Cannot convert an uninitialized amount to a double"));
 
-  mpfr_set_q(tempf, MP(quantity), GMP_RNDN);
+  mpfr_set_q(tempf, MP_CONST(quantity), GMP_RNDN);
   return mpfr_get_d(tempf, GMP_RNDN);
 }
 
@@ -712,13 +980,13 @@ long amount_t::to_long() const
   if (! quantity)
     throw_(amount_error, _("Cannot convert an uninitialized amount to a long"));
 
-  mpfr_set_q(tempf, MP(quantity), GMP_RNDN);
+  mpfr_set_q(tempf, MP_CONST(quantity), GMP_RNDN);
   return mpfr_get_si(tempf, GMP_RNDN);
 }
 
 bool amount_t::fits_in_long() const
 {
-  mpfr_set_q(tempf, MP(quantity), GMP_RNDN);
+  mpfr_set_q(tempf, MP_CONST(quantity), GMP_RNDN);
   return mpfr_fits_slong_p(tempf, GMP_RNDN);
 }
 
@@ -804,6 +1072,29 @@ amount_t amount_t::strip_annotations(const keep_details_t& what_to_keep) const
 
 
 namespace {
+  // Read an optionally negative run of at most 18 digits, which always
+  // fits in a 64-bit integer.
+  bool parse_fixed(const char * p, int64_t& value)
+  {
+    bool negative = *p == '-';
+    if (negative)
+      p++;
+
+    const char * beg = p;
+    value = 0;
+    for (; std::isdigit(static_cast<unsigned char>(*p)); p++) {
+      if (p - beg == 18)
+	return false;
+      value = value * 10 + (*p - '0');
+    }
+    if (*p || p == beg)
+      return false;
+
+    if (negative)
+      value = - value;
+    return true;
+  }
+
   void parse_quantity(std::istream& in, string& value)
   {
     char buf[256];
@@ -889,12 +1180,12 @@ bool amount_t::parse(std::istream& in, const parse_flags_t& flags)
   std::auto_ptr<bigint_t> safe_holder;
 
   if (! quantity) {
-    quantity = new bigint_t;
+    quantity = bigint_t::create();
     safe_holder.reset(quantity);
   }
   else if (quantity->ref > 1) {
     _release();
-    quantity = new bigint_t;
+    quantity = bigint_t::create();
     safe_holder.reset(quantity);
   }
 
@@ -962,11 +1253,16 @@ bool amount_t::parse(std::istream& in, const parse_flags_t& flags)
   // Now we have the final number.  Remove commas and periods, if
   // necessary.
 
+  scoped_array<char> buf;
+  const char *	     digits = quant.c_str();
+
   if (last_comma != string::npos || last_period != string::npos) {
-    int		       len = quant.length();
-    scoped_array<char> buf(new char[len + 1]);
-    const char *       p   = quant.c_str();
-    char *	       t   = buf.get();
+    int		 len = quant.length();
+    const char * p   = quant.c_str();
+    char *	 t;
+
+    buf.reset(new char[len + 1]);
+    t = buf.get();
 
     while (*p) {
       if (*p == ',' || *p == '.')
@@ -975,18 +1271,26 @@ bool amount_t::parse(std::istream& in, const parse_flags_t& flags)
     }
     *t = '\0';
 
-    mpq_set_str(MP(quantity), buf.get(), 10);
+    digits = buf.get();
+  }
+
+  int64_t value;
+  if (quantity->prec <= max_fixed_scale && parse_fixed(digits, value)) {
+    quantity->set_fixed(value, quantity->prec);
+  }
+  else if (last_comma != string::npos || last_period != string::npos) {
+    mpq_set_str(MP(quantity), digits, 10);
     mpz_ui_pow_ui(temp, 10, quantity->prec);
     mpq_set_z(tempq, temp);
     mpq_div(MP(quantity), MP(quantity), tempq);
 
     IF_DEBUG("amount.parse") {
-      char * buf = mpq_get_str(NULL, 10, MP(quantity));
+      char * buf = mpq_get_str(NULL, 10, MP_CONST(quantity));
       DEBUG("amount.parse", "Rational parsed = " << buf);
       std::free(buf);
     }
   } else {
-    mpq_set_str(MP(quantity), quant.c_str(), 10);
+    mpq_set_str(MP(quantity), digits, 10);
   }
 
   if (negative)
@@ -1040,7 +1344,7 @@ void amount_t::print(std::ostream& _out) const
       out << " ";
   }
 
-  stream_out_mpq(out, MP(quantity), display_precision(),
+  stream_out_mpq(out, MP_CONST(quantity), display_precision(),
 		 comm ? commodity().precision() : 0, comm);
 
   if (comm.has_flags(COMMODITY_STYLE_SUFFIXED)) {
@@ -1059,6 +1363,89 @@ void amount_t::print(std::ostream& _out) const
   _out << out.str();
 }
 
+namespace {
+  void write_mpz(std::ostream& out, mpz_srcptr z)
+  {
+    std::size_t count = (mpz_sizeinbase(z, 2) + 7) / 8;
+    scoped_array<char> buf(new char[count]);
+    mpz_export(buf.get(), &count, 1, 1, 0, 0, z);
+
+    char	  negative = mpz_sgn(z) < 0;
+    uint_least32_t length   = static_cast<uint_least32_t>(count);
+    out.write(&negative, sizeof(negative));
+    out.write(reinterpret_cast<char *>(&length), sizeof(length));
+    out.write(buf.get(), static_cast<std::streamsize>(count));
+  }
+
+  void read_bytes(const char *& data, const char * end,
+		  void * buf, std::size_t length)
+  {
+    if (static_cast<std::size_t>(end - data) < length)
+      throw_(amount_error, _("Failed to read amount quantity"));
+    std::memcpy(buf, data, length);
+    data += length;
+  }
+
+  void read_mpz(const char *& data, const char * end, mpz_ptr z)
+  {
+    char	  negative;
+    uint_least32_t length;
+    read_bytes(data, end, &negative, sizeof(negative));
+    read_bytes(data, end, &length, sizeof(length));
+
+    if (static_cast<std::size_t>(end - data) < length)
+      throw_(amount_error, _("Failed to read amount quantity"));
+
+    if (length == 0)
+      mpz_set_ui(z, 0);
+    else
+      mpz_import(z, length, 1, 1, 0, 0, data);
+    data += length;
+
+    if (negative)
+      mpz_neg(z, z);
+  }
+}
+
+void amount_t::write_quantity(std::ostream& out) const
+{
+  VERIFY(valid());
+
+  char kind = 0;
+  if (quantity)
+    kind = quantity->has_flags(BIGINT_KEEP_PREC) ? 2 : 1;
+  out.write(&kind, sizeof(kind));
+
+  if (quantity) {
+    out.write(reinterpret_cast<const char *>(&quantity->prec),
+	      sizeof(quantity->prec));
+    write_mpz(out, mpq_numref(MP_CONST(quantity)));
+    write_mpz(out, mpq_denref(MP_CONST(quantity)));
+  }
+}
+
+void amount_t::read_quantity(const char *& data, const char * end)
+{
+  _clear();
+
+  char kind;
+  read_bytes(data, end, &kind, sizeof(kind));
+  if (kind == 0)
+    return;
+
+  // The new quantity belongs to this amount from the start, so that it is
+  // released along with it should the reading fail part way.
+  quantity = bigint_t::create();
+
+  read_bytes(data, end, &quantity->prec, sizeof(quantity->prec));
+  read_mpz(data, end, mpq_numref(MP(quantity)));
+  read_mpz(data, end, mpq_denref(MP(quantity)));
+  if (kind == 2)
+    quantity->add_flags(BIGINT_KEEP_PREC);
+
+  VERIFY(valid());
+}
+
 bool amount_t::valid() const
 {
   if (quantity) {
@@ -94,6 +94,11 @@ public:
       @note Normally called by session_t::shutdown(). */
   static void shutdown();
 
+  /** Log, under --verbose, how many quantities have been allocated, how
+      many times a released one was reused instead, and the most that
+      were in use at once. */
+  static void log_statistics();
+
   static bool is_initialized;
 
   /** The amount's decimal precision. */
@@ -244,6 +249,10 @@ public:
       compared. */
   bool operator==(const amount_t& amt) const;
 
+  /** Compute a hash of the amount, such that equal amounts hash alike.
+      This allows amounts to serve as keys of boost::unordered_map. */
+  std::size_t hash() const;
+
   template <typename T>
   bool operator==(const T& val) const {
     return compare(val) == 0;
@@ -666,6 +675,24 @@ public:
 
   /*@}*/
 
+  /** @name Serialization
+   */
+  /*@{*/
+
+  /** An amount's quantity may be written to a binary stream using
+      `write_quantity', and read back again using `read_quantity'.  Only
+      the number itself is written, at its full internal precision; the
+      caller must record the amount's commodity in whatever way it
+      identifies commodities, and restore it with set_commodity() after
+      reading the quantity back.  Reading is done directly from memory,
+      advancing `data' past the quantity read, but never beyond `end'.
+      This is used by the binary journal cache (see archive.h).
+  */
+  void write_quantity(std::ostream& out) const;
+  void read_quantity(const char *& data, const char * end);
+
+  /*@}*/
+
   /** @name Debugging
    */
   /*@{*/
@@ -728,6 +755,10 @@ inline std::istream& operator>>(std::istream& in, amount_t& amt) {
   return in;
 }
 
+inline std::size_t hash_value(const amount_t& amt) {
+  return amt.hash();
+}
+
 } // namespace ledger
 
 #endif // _AMOUNT_H
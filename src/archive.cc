@@ -0,0 +1,759 @@
+/*
+ * Copyright (c) 2003-2009, John Wiegley.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * - Neither the name of New Artisans LLC nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <system.hh>
+
+#include "archive.h"
+#include "journal.h"
+#include "xact.h"
+#include "post.h"
+#include "account.h"
+#include "commodity.h"
+#include "mapped.h"
+
+namespace ledger {
+
+namespace {
+  // Bump this whenever the layout written below changes, so that caches
+  // written by another version of Ledger are simply reparsed.
+  const uint_least32_t ARCHIVE_MAGIC   = 0x4c444743; // "LDGC"
+  const uint_least32_t ARCHIVE_VERSION = 0x00030004;
+
+  template <typename T>
+  void write_binary(std::ostream& out, const T& value)
+  {
+    out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+  }
+
+  void write_string(std::ostream& out, const string& str)
+  {
+    write_binary(out, static_cast<uint_least32_t>(str.length()));
+    out.write(str.data(), static_cast<std::streamsize>(str.length()));
+  }
+
+  void write_optional_string(std::ostream& out, const optional<string>& str)
+  {
+    write_binary(out, static_cast<bool>(str));
+    if (str)
+      write_string(out, *str);
+  }
+
+  void write_date(std::ostream& out, const date_t& when)
+  {
+    write_binary(out, static_cast<uint_least32_t>(when.day_number()));
+  }
+
+  void write_optional_date(std::ostream& out, const optional<date_t>& when)
+  {
+    write_binary(out, static_cast<bool>(when));
+    if (when)
+      write_date(out, *when);
+  }
+
+  void write_datetime(std::ostream& out, const datetime_t& when)
+  {
+    write_date(out, when.date());
+    write_binary(out, static_cast<int64_t>(when.time_of_day().ticks()));
+  }
+
+  /**
+   * Commodities and accounts are written once each, and afterward
+   * referred to by their position in the order written.  Zero stands for
+   * no commodity or account at all.
+   */
+  class archive_writer_t
+  {
+    std::ostream& out;
+
+    std::map<const commodity_t *, uint_least32_t> commodity_ids;
+    std::map<const account_t *, uint_least32_t>	  account_ids;
+    std::map<string, uint_least32_t>		  pathname_ids;
+
+  public:
+    archive_writer_t(std::ostream& _out) : out(_out) {}
+
+    // Every item records the file it came from, but there are only ever a
+    // few such files; each is written out in full only the first time.
+    void write_path(const path& pathname) {
+      std::map<string, uint_least32_t>::iterator i =
+	pathname_ids.find(pathname.string());
+      if (i != pathname_ids.end()) {
+	write_binary(out, (*i).second);
+      } else {
+	write_binary(out, static_cast<uint_least32_t>(0));
+	write_string(out, pathname.string());
+	pathname_ids.insert(std::pair<string, uint_least32_t>
+			    (pathname.string(), static_cast<uint_least32_t>
+			     (pathname_ids.size() + 1)));
+      }
+    }
+
+    void write_commodity_ref(const commodity_t * comm) {
+      if (! comm) {
+	write_binary(out, static_cast<uint_least32_t>(0));
+      } else {
+	std::map<const commodity_t *, uint_least32_t>::iterator i =
+	  commodity_ids.find(comm);
+	assert(i != commodity_ids.end());
+	write_binary(out, (*i).second);
+      }
+    }
+
+    void write_account_ref(const account_t * acct) {
+      if (! acct) {
+	write_binary(out, static_cast<uint_least32_t>(0));
+      } else {
+	std::map<const account_t *, uint_least32_t>::iterator i =
+	  account_ids.find(acct);
+	assert(i != account_ids.end());
+	write_binary(out, (*i).second);
+      }
+    }
+
+    void write_amount(const amount_t& amt) {
+      write_commodity_ref(amt.has_commodity() ? &amt.commodity() : NULL);
+      amt.write_quantity(out);
+    }
+
+    void write_optional_amount(const optional<amount_t>& amt) {
+      write_binary(out, static_cast<bool>(amt));
+      if (amt)
+	write_amount(*amt);
+    }
+
+    void write_commodity(const commodity_t& comm,
+			 std::list<const commodity_t *>& defined) {
+      if (commodity_ids.find(&comm) != commodity_ids.end())
+	return;
+
+      if (comm.annotated) {
+	const annotated_commodity_t& ann(as_annotated_commodity(comm));
+
+	// An annotation's price may itself be in an annotated commodity,
+	// which must then be written first.
+	if (ann.details.price && ann.details.price->has_commodity())
+	  write_commodity(ann.details.price->commodity(), defined);
+
+	write_commodity(ann.referent(), defined);
+
+	write_binary(out, true);
+	write_binary(out, true);
+	write_commodity_ref(&ann.referent());
+	write_string(out, ann.mapping_key());
+	write_binary(out, ann.details.flags());
+	write_optional_amount(ann.details.price);
+	write_optional_date(out, ann.details.date);
+	write_optional_string(out, ann.details.tag);
+      } else {
+	write_binary(out, true);
+	write_binary(out, false);
+	write_string(out, comm.base_symbol());
+	write_binary(out, comm.base->flags());
+	write_binary(out, comm.precision());
+	write_optional_string(out, comm.name());
+	write_optional_string(out, comm.note());
+      }
+
+      uint_least32_t id = static_cast<uint_least32_t>(defined.size() + 1);
+      commodity_ids.insert(std::pair<const commodity_t *, uint_least32_t>
+			   (&comm, id));
+      defined.push_back(&comm);
+    }
+
+    void write_commodities(const commodity_pool_t& pool) {
+      typedef commodity_pool_t::commodities_map commodities_map;
+
+      std::list<const commodity_t *> defined;
+
+      // Commodities are written in order of their addresses, which is
+      // about the order they were created in, so that reading them back
+      // creates them again in that same order.  Some reports fall back on
+      // the address to order commodities which otherwise compare equal,
+      // and this keeps their output the same whether the journal was
+      // parsed or loaded from the cache.
+      std::vector<const commodity_t *> all;
+      foreach (const commodities_map::value_type& pair, pool.commodities)
+	all.push_back(pair.second);
+      std::sort(all.begin(), all.end(), std::less<const commodity_t *>());
+
+      foreach (const commodity_t * comm, all)
+	write_commodity(*comm, defined);
+      write_binary(out, false);
+
+      // Conversions and price histories may refer to any commodity, and so
+      // are only written now that all have been defined.
+      foreach (const commodity_t * comm, defined) {
+	if (comm->annotated)
+	  continue;
+
+	write_optional_amount(comm->smaller());
+	write_optional_amount(comm->larger());
+
+	const optional<commodity_t::varied_history_t>& hist =
+	  comm->base->varied_history;
+	write_binary(out, static_cast<uint_least32_t>
+		     (hist ? hist->histories.size() : 0));
+	if (hist) {
+	  foreach (const commodity_t::history_by_commodity_map::value_type&
+		   pair, hist->histories) {
+	    write_commodity_ref(pair.first);
+	    write_binary(out, static_cast<uint_least32_t>
+			 (pair.second.prices.size()));
+	    foreach (const commodity_t::history_map::value_type& price,
+		     pair.second.prices) {
+	      write_datetime(out, price.first);
+	      write_amount(price.second);
+	    }
+	  }
+	}
+      }
+
+      write_commodity_ref(pool.default_commodity);
+    }
+
+    void write_account(const account_t& acct) {
+      account_ids.insert(std::pair<const account_t *, uint_least32_t>
+			 (&acct, static_cast<uint_least32_t>
+			  (account_ids.size() + 1)));
+
+      write_string(out, acct.name);
+      write_optional_string(out, acct.note);
+      write_binary(out, acct.known);
+
+      write_binary(out, static_cast<uint_least32_t>(acct.accounts.size()));
+      foreach (const accounts_map::value_type& pair, acct.accounts)
+	write_account(*pair.second);
+    }
+
+    void write_item(const item_t& item) {
+      write_binary(out, item.flags());
+      write_binary(out, static_cast<uint_least8_t>(item.state()));
+      write_optional_date(out, item._date);
+      write_optional_date(out, item._date_eff);
+      write_optional_string(out, item.note);
+
+      write_binary(out, static_cast<bool>(item.metadata));
+      if (item.metadata) {
+	write_binary(out, static_cast<uint_least32_t>(item.metadata->size()));
+	foreach (const item_t::string_map::value_type& pair, *item.metadata) {
+	  write_string(out, pair.first);
+	  write_optional_string(out, pair.second);
+	}
+      }
+
+      write_path(item.pathname);
+      write_binary(out, static_cast<int64_t>(std::streamoff(item.beg_pos)));
+      write_binary(out, static_cast<uint_least32_t>(item.beg_line));
+      write_binary(out, static_cast<int64_t>(std::streamoff(item.end_pos)));
+      write_binary(out, static_cast<uint_least32_t>(item.end_line));
+    }
+
+    void write_posts(const xact_base_t& xact) {
+      write_binary(out, static_cast<uint_least32_t>(xact.posts.size()));
+      foreach (const post_t * post, xact.posts) {
+	write_item(*post);
+	write_account_ref(post->account);
+	write_amount(post->amount);
+	write_optional_amount(post->cost);
+	write_optional_amount(post->assigned_amount);
+      }
+    }
+
+    void write_journal(const journal_t& journal) {
+      write_commodities(*amount_t::current_pool);
+
+      write_account(*journal.master);
+      write_account_ref(journal.basket);
+
+      write_binary(out, static_cast<uint_least32_t>(journal.xacts.size()));
+      foreach (const xact_t * xact, journal.xacts) {
+	write_item(*xact);
+	write_optional_string(out, xact->code);
+	write_string(out, xact->payee);
+	write_posts(*xact);
+      }
+
+      write_binary(out, static_cast<uint_least32_t>
+		   (journal.auto_xacts.size()));
+      foreach (const auto_xact_t * xact, journal.auto_xacts) {
+	write_string(out, xact->predicate.predicate.text());
+	write_binary(out, xact->predicate.what_to_keep.keep_price);
+	write_binary(out, xact->predicate.what_to_keep.keep_date);
+	write_binary(out, xact->predicate.what_to_keep.keep_tag);
+	write_binary(out, xact->predicate.what_to_keep.only_actuals);
+	write_item(*xact);
+	write_posts(*xact);
+      }
+
+      write_binary(out, static_cast<uint_least32_t>
+		   (journal.period_xacts.size()));
+      foreach (const period_xact_t * xact, journal.period_xacts) {
+	write_string(out, xact->period_string);
+	write_item(*xact);
+	write_posts(*xact);
+      }
+
+      write_binary(out, ARCHIVE_MAGIC);
+    }
+  };
+
+  /**
+   * The cache is read straight out of memory, rather than through an
+   * istream, since it consists almost entirely of very small fields.
+   */
+  class archive_reader_t
+  {
+    const char * data;
+    const char * end;
+
+    std::vector<commodity_t *> commodities;
+    std::vector<account_t *>   accounts;
+    std::vector<path>	       pathnames;
+
+  public:
+    // The files the cache was written from, as read from its header.
+    std::list<journal_t::fileinfo_t> sources;
+
+    archive_reader_t(const char * _data, const char * _end)
+      : data(_data), end(_end) {}
+
+    void check_length(std::size_t length) {
+      if (static_cast<std::size_t>(end - data) < length)
+	throw_(archive_error, _("Unexpected end of cache file"));
+    }
+
+    template <typename T>
+    T read_binary() {
+      check_length(sizeof(T));
+      T value;
+      std::memcpy(&value, data, sizeof(T));
+      data += sizeof(T);
+      return value;
+    }
+
+    string read_string() {
+      uint_least32_t len = read_binary<uint_least32_t>();
+      check_length(len);
+      string str(data, len);
+      data += len;
+      return str;
+    }
+
+    optional<string> read_optional_string() {
+      if (read_binary<bool>())
+	return read_string();
+      return none;
+    }
+
+    date_t read_date() {
+      return date_t(boost::gregorian::gregorian_calendar::from_day_number
+		    (read_binary<uint_least32_t>()));
+    }
+
+    optional<date_t> read_optional_date() {
+      if (read_binary<bool>())
+	return read_date();
+      return none;
+    }
+
+    datetime_t read_datetime() {
+      date_t  day   = read_date();
+      int64_t ticks = read_binary<int64_t>();
+      return datetime_t(day, time_duration_t(0, 0, 0, ticks));
+    }
+
+    const path& read_path() {
+      uint_least32_t id = read_binary<uint_least32_t>();
+      if (id == 0) {
+	pathnames.push_back(read_string());
+	return pathnames.back();
+      }
+      if (id > pathnames.size())
+	throw_(archive_error, _("Invalid path in cache file"));
+      return pathnames[id - 1];
+    }
+
+    bool read_header(const string& key) {
+      if (read_binary<uint_least32_t>() != ARCHIVE_MAGIC ||
+	  read_binary<uint_least32_t>() != ARCHIVE_VERSION) {
+	DEBUG("archive.load", "Cache file is not of this version");
+	return false;
+      }
+      if (read_string() != key) {
+	DEBUG("archive.load", "Cache file was written for other files");
+	return false;
+      }
+
+      uint_least32_t count = read_binary<uint_least32_t>();
+      for (uint_least32_t i = 0; i < count; i++) {
+	journal_t::fileinfo_t info;
+	info.filename = read_string();
+	info.size     = read_binary<uintmax_t>();
+	info.modtime  = read_binary<std::time_t>();
+	info.checksum	= read_binary<uint_least32_t>();
+	info.appendable = read_binary<bool>();
+	info.auto_xacts = read_binary<bool>();
+
+	if (info.changed()) {
+	  DEBUG("archive.load",
+		"Source file " << info.filename << " has changed");
+	  return false;
+	}
+	sources.push_back(info);
+      }
+
+      // The body is checked before anything is read from it, so that a
+      // cache which was cut short or damaged is reparsed rather than half
+      // loaded.
+      uint64_t	     length   = read_binary<uint64_t>();
+      uint_least32_t checksum = read_binary<uint_least32_t>();
+      if (static_cast<uint64_t>(end - data) != length ||
+	  text_checksum(data, end) != checksum) {
+	DEBUG("archive.load", "Cache file is incomplete or damaged");
+	return false;
+      }
+      return true;
+    }
+
+    commodity_t * read_commodity_ref() {
+      uint_least32_t id = read_binary<uint_least32_t>();
+      if (id == 0)
+	return NULL;
+      if (id > commodities.size())
+	throw_(archive_error, _("Invalid commodity in cache file"));
+      return commodities[id - 1];
+    }
+
+    account_t * read_account_ref() {
+      uint_least32_t id = read_binary<uint_least32_t>();
+      if (id == 0)
+	return NULL;
+      if (id > accounts.size())
+	throw_(archive_error, _("Invalid account in cache file"));
+      return accounts[id - 1];
+    }
+
+    void read_amount(amount_t& amt) {
+      commodity_t * comm = read_commodity_ref();
+      amt.read_quantity(data, end);
+      if (comm && ! amt.is_null())
+	amt.set_commodity(*comm);
+    }
+
+    optional<amount_t> read_optional_amount() {
+      if (read_binary<bool>()) {
+	amount_t amt;
+	read_amount(amt);
+	return amt;
+      }
+      return none;
+    }
+
+    void read_commodities(commodity_pool_t& pool) {
+      while (read_binary<bool>()) {
+	commodity_t * comm;
+
+	if (read_binary<bool>()) {
+	  commodity_t * referent = read_commodity_ref();
+	  if (! referent)
+	    throw_(archive_error, _("Invalid commodity in cache file"));
+	  string mapping_key = read_string();
+
+	  annotation_t details;
+	  details.set_flags(read_binary<annotation_t::flags_t>());
+	  details.price = read_optional_amount();
+	  details.date	= read_optional_date();
+	  details.tag	= read_optional_string();
+
+	  comm = pool.find(mapping_key);
+	  if (! comm)
+	    comm = pool.create(*referent, details, mapping_key);
+	} else {
+	  comm = pool.find_or_create(read_string());
+	  comm->base->set_flags(read_binary<uint_least16_t>());
+	  comm->set_precision(read_binary<amount_t::precision_t>());
+	  comm->set_name(read_optional_string());
+	  comm->set_note(read_optional_string());
+	}
+	commodities.push_back(comm);
+      }
+
+      foreach (commodity_t * comm, commodities) {
+	if (comm->annotated)
+	  continue;
+
+	comm->set_smaller(read_optional_amount());
+	comm->set_larger(read_optional_amount());
+
+	uint_least32_t histories = read_binary<uint_least32_t>();
+	for (uint_least32_t i = 0; i < histories; i++) {
+	  commodity_t * price_comm = read_commodity_ref();
+
+	  // The histories are restored just as they were, rather than
+	  // through add_price(), which would also record each price a
+	  // second time against the other commodity.
+	  if (! comm->base->varied_history)
+	    comm->base->varied_history = commodity_t::varied_history_t();
+	  commodity_t::history_t& hist =
+	    comm->base->varied_history->histories[price_comm];
+
+	  uint_least32_t prices = read_binary<uint_least32_t>();
+	  for (uint_least32_t j = 0; j < prices; j++) {
+	    datetime_t when = read_datetime();
+	    amount_t   price;
+	    read_amount(price);
+	    hist.prices.insert(commodity_t::history_map::value_type
+			       (when, price));
+	  }
+	}
+      }
+
+      // Since add_price() was bypassed, anything the pool has computed
+      // from the prices it knew before is forgotten here.
+      pool.price_epoch++;
+      pool.price_cache.clear();
+      pool.price_tables.clear();
+
+      pool.default_commodity = read_commodity_ref();
+    }
+
+    void read_account(account_t * acct) {
+      accounts.push_back(acct);
+
+      acct->note  = read_optional_string();
+      acct->known = read_binary<bool>();
+
+      uint_least32_t count = read_binary<uint_least32_t>();
+      for (uint_least32_t i = 0; i < count; i++)
+	read_account(acct->find_account(read_string()));
+    }
+
+    void read_item(item_t& item) {
+      item.set_flags(read_binary<item_t::flags_t>());
+      item.set_state(static_cast<item_t::state_t>
+		     (read_binary<uint_least8_t>()));
+      item._date     = read_optional_date();
+      item._date_eff = read_optional_date();
+      item.note	     = read_optional_string();
+
+      if (read_binary<bool>()) {
+	item.metadata = item_t::string_map();
+	uint_least32_t count = read_binary<uint_least32_t>();
+	for (uint_least32_t i = 0; i < count; i++) {
+	  string name = read_string();
+	  item.metadata->insert(item_t::string_map::value_type
+				(name, read_optional_string()));
+	}
+      }
+
+      item.pathname = read_path();
+      item.beg_pos  = std::streamoff(read_binary<int64_t>());
+      item.beg_line = read_binary<uint_least32_t>();
+      item.end_pos  = std::streamoff(read_binary<int64_t>());
+      item.end_line = read_binary<uint_least32_t>();
+    }
+
+    void read_posts(xact_base_t& xact) {
+      uint_least32_t count = read_binary<uint_least32_t>();
+      for (uint_least32_t i = 0; i < count; i++) {
+	std::auto_ptr<post_t> post(new post_t);
+	read_item(*post);
+	post->account = read_account_ref();
+	if (! post->account)
+	  throw_(archive_error, _("Invalid account in cache file"));
+	read_amount(post->amount);
+	post->cost	      = read_optional_amount();
+	post->assigned_amount = read_optional_amount();
+	xact.add_post(post.release());
+      }
+    }
+
+    void read_journal(journal_t& journal) {
+      read_commodities(*amount_t::current_pool);
+
+      read_string();		// the master account has no name
+      read_account(journal.master);
+      journal.basket = read_account_ref();
+
+      uint_least32_t count = read_binary<uint_least32_t>();
+      for (uint_least32_t i = 0; i < count; i++) {
+	std::auto_ptr<xact_t> xact(new xact_t);
+	read_item(*xact);
+	xact->code  = read_optional_string();
+	xact->payee = read_string();
+	read_posts(*xact);
+
+	// The transaction was finalized when first parsed, so all that
+	// remains is to link its postings back into their accounts.
+	xact->journal = &journal;
+	foreach (post_t * post, xact->posts)
+	  post->account->add_post(post);
+	journal.xacts.push_back(xact.release());
+      }
+
+      count = read_binary<uint_least32_t>();
+      for (uint_least32_t i = 0; i < count; i++) {
+	string text	  = read_string();
+	bool keep_price	  = read_binary<bool>();
+	bool keep_date	  = read_binary<bool>();
+	bool keep_tag	  = read_binary<bool>();
+	bool only_actuals = read_binary<bool>();
+
+	std::auto_ptr<auto_xact_t> xact
+	  (new auto_xact_t(item_predicate(text,
+					  keep_details_t(keep_price, keep_date,
+							 keep_tag,
+							 only_actuals))));
+	read_item(*xact);
+	read_posts(*xact);
+	xact->journal = &journal;
+	journal.auto_xacts.push_back(xact.release());
+      }
+
+      count = read_binary<uint_least32_t>();
+      for (uint_least32_t i = 0; i < count; i++) {
+	std::auto_ptr<period_xact_t> xact(new period_xact_t(read_string()));
+	read_item(*xact);
+	read_posts(*xact);
+	xact->journal = &journal;
+	journal.period_xacts.push_back(xact.release());
+      }
+
+      if (read_binary<uint_least32_t>() != ARCHIVE_MAGIC)
+	throw_(archive_error, _("Cache file is corrupt"));
+    }
+  };
+}
+
+bool archive_t::should_save(const journal_t& journal) const
+{
+  return journal.cacheable && ! journal.sources.empty();
+}
+
+bool archive_t::load(journal_t& journal)
+{
+  if (! exists(file))
+    return false;
+
+  mapped_file_t mapped;
+  string	buffer;
+  if (! mapped.open(file)) {
+    ifstream in(file, std::ios::binary);
+    buffer.assign(std::istreambuf_iterator<char>(in),
+		  std::istreambuf_iterator<char>());
+  }
+
+  archive_reader_t reader(mapped.is_open() ? mapped.begin() : buffer.data(),
+			  mapped.is_open() ? mapped.end() :
+			  buffer.data() + buffer.length());
+  try {
+    if (! reader.read_header(key))
+      return false;
+  }
+  catch (const archive_error&) {
+    // A cache cut short before even its header is complete is as good as
+    // no cache at all.
+    return false;
+  }
+
+  INFO_START(archive, "Read cached journal file");
+
+  try {
+    reader.read_journal(journal);
+    journal.sources.swap(reader.sources);
+  }
+  catch (const std::exception& err) {
+    add_error_context(_("While reading cache file %1:") << file);
+    throw;
+  }
+
+  INFO_FINISH(archive);
+
+  DEBUG("archive.load", "Read " << journal.xacts.size()
+	<< " transactions from " << file);
+  return true;
+}
+
+void archive_t::save(const journal_t& journal)
+{
+  INFO_START(archive, "Saved journal file cache");
+
+  // The cache is written beside its final name and then moved into
+  // place, so that a reader never sees one that is only partly written.
+  path temp(file.string() + ".tmp");
+  {
+    ofstream out(temp, std::ios::binary | std::ios::trunc);
+    if (! out) {
+      DEBUG("archive.save", "Cannot write cache file " << temp);
+      return;
+    }
+
+    write_binary(out, ARCHIVE_MAGIC);
+    write_binary(out, ARCHIVE_VERSION);
+    write_string(out, key);
+
+    write_binary(out, static_cast<uint_least32_t>(journal.sources.size()));
+    foreach (const journal_t::fileinfo_t& info, journal.sources) {
+      write_string(out, info.filename.string());
+      write_binary(out, info.size);
+      write_binary(out, info.modtime);
+      write_binary(out, info.checksum);
+      write_binary(out, info.appendable);
+      write_binary(out, info.auto_xacts);
+    }
+
+    std::ostringstream body;
+    archive_writer_t(body).write_journal(journal);
+    string data(body.str());
+
+    write_binary(out, static_cast<uint64_t>(data.length()));
+    write_binary(out, text_checksum(data.data(),
+				    data.data() + data.length()));
+    out.write(data.data(), static_cast<std::streamsize>(data.length()));
+
+    if (! out.good()) {
+      DEBUG("archive.save", "Failed writing cache file " << temp);
+      out.close();
+      boost::filesystem::remove(temp);
+      return;
+    }
+  }
+
+  if (std::rename(temp.string().c_str(), file.string().c_str()) != 0) {
+    DEBUG("archive.save", "Cannot move cache file into place at " << file);
+    boost::filesystem::remove(temp);
+    return;
+  }
+
+  INFO_FINISH(archive);
+}
+
+} // namespace ledger
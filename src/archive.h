@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2003-2009, John Wiegley.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * - Neither the name of New Artisans LLC nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * @addtogroup data
+ */
+
+/**
+ * @file   archive.h
+ * @author John Wiegley
+ *
+ * @ingroup data
+ *
+ * @brief A binary cache of a parsed journal.
+ *
+ * Parsing a large journal as text is the bulk of the time taken by most
+ * reports.  When a cache file is given (with --cache), the journal is
+ * written there after it has been parsed, and on later runs read back
+ * from it in place of the text, so long as none of the files it came
+ * from have changed in the meantime.
+ */
+#ifndef _ARCHIVE_H
+#define _ARCHIVE_H
+
+#include "utils.h"
+
+namespace ledger {
+
+class journal_t;
+
+DECLARE_EXCEPTION(archive_error, std::runtime_error);
+
+/**
+ * @brief A journal cache file
+ *
+ * The key describes how the journal was read: which files were named,
+ * in which order, and any settings which change how their text is
+ * understood.  A cache written under one key is never loaded under
+ * another, nor once the size or modification time of any file the
+ * journal was read from (includes and the price database among them) is
+ * no longer what it was when the cache was written.
+ */
+class archive_t : public noncopyable
+{
+  path	 file;
+  string key;
+
+public:
+  archive_t(const path& _file, const string& _key)
+    : file(_file), key(_key) {
+    TRACE_CTOR(archive_t, "const path&, const string&");
+  }
+  ~archive_t() {
+    TRACE_DTOR(archive_t);
+  }
+
+  /**
+   * Read the cached journal into `journal', which should be empty.
+   * Returns false, having read nothing, if there is no cache file yet, if
+   * it is out of date, or if its body does not match the length and
+   * checksum in its header; the journal must then be parsed as text.
+   */
+  bool load(journal_t& journal);
+
+  bool should_save(const journal_t& journal) const;
+  void save(const journal_t& journal);
+};
+
+} // namespace ledger
+
+#endif // _ARCHIVE_H
@@ -37,6 +37,74 @@
 
 namespace ledger {
 
+balance_t::amounts_map&
+balance_t::amounts_map::operator=(const amounts_map& other)
+{
+  if (this != &other) {
+    clear();
+    reserve(other.size_);
+    for (size_type i = 0; i < other.size_; i++)
+      new (data_ + i) value_type(other.data_[i]);
+    size_ = other.size_;
+  }
+  return *this;
+}
+
+void balance_t::amounts_map::reserve(const size_type count)
+{
+  if (count <= capacity_)
+    return;
+
+  size_type new_capacity = capacity_ * 2;
+  if (new_capacity < count)
+    new_capacity = count;
+
+  value_type * new_data =
+    static_cast<value_type *>(::operator new(new_capacity * sizeof(value_type)));
+  for (size_type i = 0; i < size_; i++) {
+    new (new_data + i) value_type(data_[i]);
+    data_[i].~value_type();
+  }
+
+  if (data_ != inline_data())
+    ::operator delete(data_);
+
+  data_	    = new_data;
+  capacity_ = new_capacity;
+}
+
+std::pair<balance_t::amounts_map::iterator, bool>
+balance_t::amounts_map::insert(const value_type& pair)
+{
+  iterator i = lower_bound(pair.first);
+  if (i != end() && i->first == pair.first)
+    return std::pair<iterator, bool>(i, false);
+
+  size_type pos = i - data_;
+  reserve(size_ + 1);
+
+  if (pos == size_) {
+    new (data_ + size_) value_type(pair);
+  } else {
+    new (data_ + size_) value_type(data_[size_ - 1]);
+    for (size_type j = size_ - 1; j > pos; j--)
+      data_[j] = data_[j - 1];
+    data_[pos] = pair;
+  }
+  size_++;
+
+  return std::pair<iterator, bool>(data_ + pos, true);
+}
+
+void balance_t::amounts_map::erase(iterator i)
+{
+  assert(i >= begin() && i < end());
+
+  for (iterator last = end() - 1; i != last; i++)
+    *i = *(i + 1);
+  data_[--size_].~value_type();
+}
+
 balance_t::balance_t(const double val)
 {
   TRACE_CTOR(balance_t, "const double");
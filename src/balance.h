@@ -80,7 +80,112 @@ class balance_t
 	   multiplicative<balance_t, long> > > > > > > > > > > > > >
 {
 public:
-  typedef std::map<const commodity_t *, amount_t> amounts_map;
+  /**
+   * @class amounts_map
+   *
+   * @brief The component amounts of a balance, ordered by commodity.
+   *
+   * Balances are copied on every posting when running totals are
+   * computed, and they seldom hold more than a few commodities.  The
+   * amounts are therefore kept in a vector sorted by commodity pointer,
+   * whose first few entries live within the balance itself; only a
+   * balance of more commodities than that allocates from the heap.  The
+   * interface is the subset of std::map used on balances, and iteration
+   * visits the commodities in the same order a map would.
+   */
+  class amounts_map
+  {
+  public:
+    typedef const commodity_t *			    key_type;
+    typedef std::pair<const commodity_t *, amount_t> value_type;
+    typedef value_type *			    iterator;
+    typedef const value_type *			    const_iterator;
+    typedef std::size_t				    size_type;
+
+    enum { inline_count = 4 };
+
+  private:
+    typedef boost::aligned_storage<sizeof(value_type) * inline_count,
+				   boost::alignment_of<value_type>::value>
+      storage_type;
+
+    value_type *	      data_;
+    size_type		      size_;
+    size_type		      capacity_;
+    storage_type::type	      storage_;
+
+    value_type * inline_data() {
+      return static_cast<value_type *>(static_cast<void *>(storage_.address()));
+    }
+
+    struct key_less {
+      bool operator()(const value_type& pair, const key_type key) const {
+	return std::less<key_type>()(pair.first, key);
+      }
+    };
+
+    void reserve(const size_type count);
+
+  public:
+    amounts_map()
+      : data_(inline_data()), size_(0), capacity_(inline_count) {}
+    amounts_map(const amounts_map& other)
+      : data_(inline_data()), size_(0), capacity_(inline_count) {
+      *this = other;
+    }
+    ~amounts_map() {
+      clear();
+      if (data_ != inline_data())
+	::operator delete(data_);
+    }
+
+    amounts_map& operator=(const amounts_map& other);
+
+    iterator begin() {
+      return data_;
+    }
+    iterator end() {
+      return data_ + size_;
+    }
+    const_iterator begin() const {
+      return data_;
+    }
+    const_iterator end() const {
+      return data_ + size_;
+    }
+
+    size_type size() const {
+      return size_;
+    }
+    bool empty() const {
+      return size_ == 0;
+    }
+
+    void clear() {
+      for (size_type i = 0; i < size_; i++)
+	data_[i].~value_type();
+      size_ = 0;
+    }
+
+    iterator lower_bound(const key_type key) {
+      return std::lower_bound(begin(), end(), key, key_less());
+    }
+    const_iterator lower_bound(const key_type key) const {
+      return std::lower_bound(begin(), end(), key, key_less());
+    }
+
+    iterator find(const key_type key) {
+      iterator i = lower_bound(key);
+      return (i != end() && i->first == key) ? i : end();
+    }
+    const_iterator find(const key_type key) const {
+      const_iterator i = lower_bound(key);
+      return (i != end() && i->first == key) ? i : end();
+    }
+
+    std::pair<iterator, bool> insert(const value_type& pair);
+    void erase(iterator i);
+  };
 
   amounts_map amounts;
 
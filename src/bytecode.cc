@@ -0,0 +1,438 @@
+/*
+ * Copyright (c) 2003-2009, John Wiegley.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * - Neither the name of New Artisans LLC nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <system.hh>
+
+#include "bytecode.h"
+#include "scope.h"
+
+namespace ledger {
+
+expr_t::bytecode_t::bytecode_t(const ptr_op_t& _root)
+  : root(_root), result(NONE), running(false)
+{
+  TRACE_CTOR(bytecode_t, "const ptr_op_t&");
+
+  result = lower(root.get());
+
+  if (SHOW_DEBUG("expr.compile")) {
+    DEBUG("expr.compile", "Lowered to bytecode:");
+    dump(*_log_stream);
+  }
+}
+
+expr_t::bytecode_t::operand_t expr_t::bytecode_t::new_register()
+{
+  if (registers.size() >= CONSTANT)
+    throw_(compile_error, _("Value expression is too large to compile"));
+
+  registers.push_back(value_t());
+  return static_cast<operand_t>(registers.size() - 1);
+}
+
+expr_t::bytecode_t::operand_t
+expr_t::bytecode_t::add_constant(const value_t& val)
+{
+  if (constants.size() >= NONE - CONSTANT)
+    throw_(compile_error, _("Value expression is too large to compile"));
+
+  constants.push_back(val);
+  return static_cast<operand_t>(CONSTANT | (constants.size() - 1));
+}
+
+std::size_t expr_t::bytecode_t::emit(opcode_t		opcode,
+				     op_t *		node,
+				     operand_t		dest,
+				     operand_t		left,
+				     operand_t		right,
+				     const function_t * function)
+{
+  if (code.size() >= NONE)
+    throw_(compile_error, _("Value expression is too large to compile"));
+
+  instruction_t inst;
+  inst.opcode	= opcode;
+  inst.dest	= dest;
+  inst.left	= left;
+  inst.right	= right;
+  inst.function = function;
+  inst.node	= node;
+
+  code.push_back(inst);
+  return code.size() - 1;
+}
+
+expr_t::bytecode_t::operand_t expr_t::bytecode_t::lower(op_t * op)
+{
+  switch (op->kind) {
+  case op_t::VALUE:
+    return add_constant(op->as_value());
+
+  case op_t::FUNCTION: {
+    operand_t dest = new_register();
+    emit(CALL, op, dest, NONE, NONE, &op->as_function());
+    return dest;
+  }
+
+  case op_t::IDENT:
+    // An identifier bound directly to a function is called in place;
+    // anything else it might name is left to the tree, which also
+    // reports the identifier if it was never defined.
+    if (op->left() && op->left()->is_function()) {
+      operand_t dest = new_register();
+      emit(CALL, op, dest, NONE, NONE, &op->left()->as_function());
+      return dest;
+    }
+    break;
+
+  case op_t::O_CALL:
+    if (op->left()->left() && op->left()->left()->is_function()) {
+      operand_t args = op->has_right() ? lower(op->right().get()) : NONE;
+      operand_t dest = new_register();
+      emit(args == NONE ? CALL : CALL_ARGS, op, dest, args, NONE,
+	   &op->left()->left()->as_function());
+      return dest;
+    }
+    break;
+
+  case op_t::O_NOT:
+  case op_t::O_NEG: {
+    operand_t arg  = lower(op->left().get());
+    operand_t dest = new_register();
+    emit(op->kind == op_t::O_NOT ? NOT : NEG, op, dest, arg);
+    return dest;
+  }
+
+  case op_t::O_EQ:
+  case op_t::O_LT:
+  case op_t::O_LTE:
+  case op_t::O_GT:
+  case op_t::O_GTE:
+  case op_t::O_ADD:
+  case op_t::O_SUB:
+  case op_t::O_MUL:
+  case op_t::O_DIV:
+  case op_t::O_MATCH: {
+    opcode_t opcode;
+    switch (op->kind) {
+    case op_t::O_EQ:  opcode = EQ;  break;
+    case op_t::O_LT:  opcode = LT;  break;
+    case op_t::O_LTE: opcode = LTE; break;
+    case op_t::O_GT:  opcode = GT;  break;
+    case op_t::O_GTE: opcode = GTE; break;
+    case op_t::O_ADD: opcode = ADD; break;
+    case op_t::O_SUB: opcode = SUB; break;
+    case op_t::O_MUL: opcode = MUL; break;
+    case op_t::O_DIV: opcode = DIV; break;
+    default:	      opcode = MATCH; break;
+    }
+    operand_t lhs  = lower(op->left().get());
+    operand_t rhs  = lower(op->right().get());
+    operand_t dest = new_register();
+    emit(opcode, op, dest, lhs, rhs);
+    return dest;
+  }
+
+  case op_t::O_AND: {
+    operand_t   dest = new_register();
+    operand_t   lhs  = lower(op->left().get());
+    std::size_t skip = emit(JUMP_IF_FALSE, op, NONE, lhs);
+    emit(MOVE, op, dest, lower(op->right().get()));
+    std::size_t done = emit(JUMP, op);
+    code[skip].right = static_cast<operand_t>(code.size());
+    emit(MOVE, op, dest, add_constant(false));
+    code[done].right = static_cast<operand_t>(code.size());
+    return dest;
+  }
+
+  case op_t::O_OR: {
+    operand_t   dest = new_register();
+    operand_t   lhs  = lower(op->left().get());
+    emit(MOVE, op, dest, lhs);
+    std::size_t done = emit(JUMP_IF_TRUE, op, NONE, lhs);
+    emit(MOVE, op, dest, lower(op->right().get()));
+    code[done].right = static_cast<operand_t>(code.size());
+    return dest;
+  }
+
+  case op_t::O_QUERY: {
+    assert(op->right());
+    assert(op->right()->kind == op_t::O_COLON);
+
+    operand_t   dest = new_register();
+    operand_t   cond = lower(op->left().get());
+    std::size_t skip = emit(JUMP_IF_FALSE, op, NONE, cond);
+    emit(MOVE, op, dest, lower(op->right()->left().get()));
+    std::size_t done = emit(JUMP, op);
+    code[skip].right = static_cast<operand_t>(code.size());
+    emit(MOVE, op, dest, lower(op->right()->right().get()));
+    code[done].right = static_cast<operand_t>(code.size());
+    return dest;
+  }
+
+  case op_t::O_CONS: {
+    if (! op->has_right())
+      return lower(op->left().get());
+
+    operand_t dest = new_register();
+    emit(CLEAR, op, dest);
+    emit(PUSH, op, dest, lower(op->left().get()));
+
+    ptr_op_t next = op->right();
+    while (next) {
+      ptr_op_t value_op;
+      if (next->kind == op_t::O_CONS) {
+	value_op = next->left();
+	next	 = next->right();
+      } else {
+	value_op = next;
+	next	 = NULL;
+      }
+      emit(PUSH, op, dest, lower(value_op.get()));
+    }
+    return dest;
+  }
+
+  case op_t::O_SEQ: {
+    assert(op->has_right());
+    operand_t last = lower(op->left().get());
+
+    ptr_op_t next = op->right();
+    while (next) {
+      ptr_op_t value_op;
+      if (next->kind == op_t::O_SEQ) {
+	value_op = next->left();
+	next	 = next->right();
+      } else {
+	value_op = next;
+	next	 = NULL;
+      }
+      last = lower(value_op.get());
+    }
+    return last;
+  }
+
+  default:
+    break;
+  }
+
+  // Definitions, member lookups and calls to user-defined functions all
+  // depend on scopes created during evaluation, so they are left to
+  // op_t::calc.
+  operand_t dest = new_register();
+  emit(EVAL, op, dest);
+  return dest;
+}
+
+namespace {
+  struct running_guard
+  {
+    bool& running;
+    running_guard(bool& _running) : running(_running) {
+      running = true;
+    }
+    ~running_guard() {
+      running = false;
+    }
+  };
+}
+
+value_t expr_t::bytecode_t::run(scope_t& scope, ptr_op_t * locus)
+{
+  // If a function called from this expression ends up evaluating it
+  // again, the nested run gets a register file of its own.
+  std::vector<value_t>  local_registers;
+  std::vector<value_t>& regs(running ? local_registers : registers);
+  if (running)
+    local_registers.resize(registers.size());
+
+  running_guard guard(running);
+
+#define OPERAND(x) \
+  ((x) & CONSTANT ? constants[(x) & ~CONSTANT] : regs[x])
+
+  const instruction_t * inst = NULL;
+  try {
+    const std::size_t count = code.size();
+    for (std::size_t pc = 0; pc < count; pc++) {
+      inst = &code[pc];
+
+      switch (inst->opcode) {
+      case EVAL:
+	regs[inst->dest] = inst->node->calc(scope, locus);
+	break;
+
+      case CALL: {
+	call_scope_t call_args(scope);
+	regs[inst->dest] = (*inst->function)(call_args);
+	break;
+      }
+      case CALL_ARGS: {
+	call_scope_t call_args(scope);
+	call_args.set_args(OPERAND(inst->left));
+	regs[inst->dest] = (*inst->function)(call_args);
+	break;
+      }
+
+      case MOVE:
+	regs[inst->dest] = OPERAND(inst->left);
+	break;
+      case CLEAR:
+	regs[inst->dest] = NULL_VALUE;
+	break;
+      case PUSH:
+	regs[inst->dest].push_back(OPERAND(inst->left));
+	break;
+
+      case NOT:
+	regs[inst->dest] = ! OPERAND(inst->left);
+	break;
+      case NEG:
+	regs[inst->dest] = OPERAND(inst->left).negated();
+	break;
+
+      case EQ:
+	regs[inst->dest] = OPERAND(inst->left) == OPERAND(inst->right);
+	break;
+      case LT:
+	regs[inst->dest] = OPERAND(inst->left) <  OPERAND(inst->right);
+	break;
+      case LTE:
+	regs[inst->dest] = OPERAND(inst->left) <= OPERAND(inst->right);
+	break;
+      case GT:
+	regs[inst->dest] = OPERAND(inst->left) >  OPERAND(inst->right);
+	break;
+      case GTE:
+	regs[inst->dest] = OPERAND(inst->left) >= OPERAND(inst->right);
+	break;
+
+      case ADD:
+	regs[inst->dest] = OPERAND(inst->left) + OPERAND(inst->right);
+	break;
+      case SUB:
+	regs[inst->dest] = OPERAND(inst->left) - OPERAND(inst->right);
+	break;
+      case MUL:
+	regs[inst->dest] = OPERAND(inst->left) * OPERAND(inst->right);
+	break;
+      case DIV:
+	regs[inst->dest] = OPERAND(inst->left) / OPERAND(inst->right);
+	break;
+
+      case MATCH:
+	regs[inst->dest] = (OPERAND(inst->right).as_mask()
+			    .match(OPERAND(inst->left).to_string()));
+	break;
+
+      case JUMP:
+	pc = inst->right - 1;
+	break;
+      case JUMP_IF_FALSE:
+	if (! OPERAND(inst->left))
+	  pc = inst->right - 1;
+	break;
+      case JUMP_IF_TRUE:
+	if (OPERAND(inst->left))
+	  pc = inst->right - 1;
+	break;
+
+      default:
+	assert(false);
+	break;
+      }
+    }
+
+    value_t temp(OPERAND(result));
+
+    // Let go of any intermediate results between runs, so that the
+    // registers don't keep pointers to journal items alive.
+    if (&regs == &registers)
+      for (std::size_t i = 0; i < registers.size(); i++)
+	registers[i] = NULL_VALUE;
+
+    return temp;
+  }
+  catch (const std::exception& err) {
+    if (locus && ! *locus && inst)
+      *locus = inst->node;
+    throw;
+  }
+
+#undef OPERAND
+}
+
+namespace {
+  void dump_operand(std::ostream& out, expr_t::bytecode_t::operand_t x)
+  {
+    if (x == expr_t::bytecode_t::NONE)
+      out << "   -";
+    else if (x & expr_t::bytecode_t::CONSTANT)
+      out << " k" << std::left << std::setw(2)
+	  << (x & ~expr_t::bytecode_t::CONSTANT) << std::right;
+    else
+      out << " r" << std::left << std::setw(2) << x << std::right;
+  }
+}
+
+void expr_t::bytecode_t::dump(std::ostream& out) const
+{
+  static const char * names[] = {
+    "EVAL", "CALL", "CALL_ARGS", "MOVE", "CLEAR", "PUSH", "NOT", "NEG",
+    "EQ", "LT", "LTE", "GT", "GTE", "ADD", "SUB", "MUL", "DIV", "MATCH",
+    "JUMP", "JUMP_IF_FALSE", "JUMP_IF_TRUE"
+  };
+
+  for (std::size_t i = 0; i < constants.size(); i++)
+    out << "  k" << i << " = " << constants[i] << std::endl;
+
+  for (std::size_t pc = 0; pc < code.size(); pc++) {
+    const instruction_t& inst(code[pc]);
+    out << std::setw(4) << pc << "  " << std::left << std::setw(14)
+	<< names[inst.opcode] << std::right;
+    dump_operand(out, inst.dest);
+    dump_operand(out, inst.left);
+    if (inst.opcode == JUMP || inst.opcode == JUMP_IF_FALSE ||
+	inst.opcode == JUMP_IF_TRUE)
+      out << " @" << inst.right;
+    else
+      dump_operand(out, inst.right);
+    if (inst.opcode == EVAL)
+      out << "  ; " << op_context(inst.node);
+    out << std::endl;
+  }
+
+  out << "  result";
+  dump_operand(out, result);
+  out << std::endl;
+}
+
+} // namespace ledger
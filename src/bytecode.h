@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2003-2009, John Wiegley.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * - Neither the name of New Artisans LLC nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @addtogroup expr
+ */
+
+/**
+ * @file   bytecode.h
+ * @author John Wiegley
+ *
+ * @ingroup expr
+ *
+ * @brief Value expressions lowered to a flat list of instructions.
+ *
+ * Once an expression has been compiled, its tree of op_t nodes is
+ * walked once more and turned into a sequence of instructions over a
+ * set of numbered registers.  Evaluating that sequence is a single
+ * loop: there is no recursion from node to node, functions are called
+ * through pointers found when the expression was lowered, and constants
+ * are read in place rather than copied out of their nodes.
+ */
+#ifndef _BYTECODE_H
+#define _BYTECODE_H
+
+#include "op.h"
+
+namespace ledger {
+
+/**
+ * @brief A value expression as a list of instructions
+ *
+ * Each instruction reads up to two operands and writes its result to a
+ * register.  An operand names either a register or, with CONSTANT set,
+ * one of the constants.  Whatever cannot be lowered, such as function
+ * definitions and member lookups, is left to be evaluated by its node
+ * in the usual way, by an EVAL instruction.
+ */
+class expr_t::bytecode_t : public noncopyable
+{
+public:
+  typedef uint_least16_t operand_t;
+
+  static const operand_t CONSTANT = 0x8000;
+  static const operand_t NONE	  = 0xffff;
+
+  enum opcode_t {
+    EVAL,			// node->calc(scope)
+    CALL,			// function(scope)
+    CALL_ARGS,			// function(scope, left)
+    MOVE,
+    CLEAR,
+    PUSH,			// dest.push_back(left)
+    NOT,
+    NEG,
+    EQ,
+    LT,
+    LTE,
+    GT,
+    GTE,
+    ADD,
+    SUB,
+    MUL,
+    DIV,
+    MATCH,
+    JUMP,			// to right
+    JUMP_IF_FALSE,		// to right, unless left
+    JUMP_IF_TRUE		// to right, if left
+  };
+
+  struct instruction_t
+  {
+    opcode_t	       opcode;
+    operand_t	       dest;
+    operand_t	       left;
+    operand_t	       right;
+    const function_t * function;
+    op_t *	       node;	// the node this was lowered from
+  };
+
+private:
+  ptr_op_t		     root;
+  std::vector<instruction_t> code;
+  std::vector<value_t>	     constants;
+  std::vector<value_t>	     registers;
+  operand_t		     result;
+  bool			     running;
+
+public:
+  explicit bytecode_t(const ptr_op_t& _root);
+  ~bytecode_t() {
+    TRACE_DTOR(bytecode_t);
+  }
+
+  value_t run(scope_t& scope, ptr_op_t * locus = NULL);
+
+  void dump(std::ostream& out) const;
+
+private:
+  operand_t lower(op_t * op);
+
+  operand_t new_register();
+  operand_t add_constant(const value_t& val);
+
+  std::size_t emit(opcode_t	      opcode,
+		   op_t *	      node,
+		   operand_t	      dest  = NONE,
+		   operand_t	      left  = NONE,
+		   operand_t	      right = NONE,
+		   const function_t * function = NULL);
+};
+
+} // namespace ledger
+
+#endif // _BYTECODE_H
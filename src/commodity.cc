@@ -33,6 +33,7 @@
 
 #include "amount.h"
 #include "commodity.h"
+#include "pricedb.h"
 
 namespace ledger {
 
@@ -45,14 +46,10 @@ void commodity_t::base_t::history_t::add_price(commodity_t&      source,
 	<< (reflexive ? " (secondary)" : " (primary)")
 	<< " : " << date << ", " << price);
 
-  history_map::iterator i = prices.find(date);
-  if (i != prices.end()) {
-    (*i).second = price;
-  } else {
-    std::pair<history_map::iterator, bool> result
-      = prices.insert(history_map::value_type(date, price));
-    assert(result.second);
-  }
+  std::pair<history_map::iterator, bool> result
+    = prices.insert(history_map::value_type(date, price));
+  if (! result.second)
+    (*result.first).second = price;
 
   if (reflexive) {
     amount_t inverse = price.inverted();
@@ -65,6 +62,12 @@ void commodity_t::base_t::history_t::add_price(commodity_t&      source,
   }
 }
 
+void commodity_t::base_t::history_t::dates(std::vector<datetime_t>& into) const
+{
+  foreach (const history_map::value_type& price, prices)
+    into.push_back(price.first);
+}
+
 bool commodity_t::base_t::history_t::remove_price(const datetime_t& date)
 {
   DEBUG("commodity.prices.add", "remove_price: " << date);
@@ -137,7 +140,7 @@ optional<price_point_t>
   }
 #endif
 
-  if (prices.size() == 0) {
+  if (prices.empty() && stored.empty()) {
 #if defined(DEBUG_ON)
     DEBUG_INDENT("commodity.prices.find", indent);
     DEBUG("commodity.prices.find", "  there are no prices in this history");
@@ -145,10 +148,14 @@ optional<price_point_t>
     return none;
   }
 
-  if (! moment) {
-    history_map::const_reverse_iterator r = prices.rbegin();
-    point.when	= (*r).first;
-    point.price = (*r).second;
+  if (prices.empty()) {
+    // All of this history's prices are in the price store.
+  }
+  else if (! moment || prices.back().first <= *moment) {
+    // Reports mostly ask for prices at or after the last one known, so
+    // this is checked before searching.
+    point.when	= prices.back().first;
+    point.price = prices.back().second;
     found = true;
 #if defined(DEBUG_ON)
     DEBUG_INDENT("commodity.prices.find", indent);
@@ -156,31 +163,34 @@ optional<price_point_t>
 #endif
   } else {
     history_map::const_iterator i = prices.lower_bound(*moment);
-    if (i == prices.end()) {
-      history_map::const_reverse_iterator r = prices.rbegin();
-      point.when  = (*r).first;
-      point.price = (*r).second;
-      found = true;
-#if defined(DEBUG_ON)
-      DEBUG_INDENT("commodity.prices.find", indent);
-      DEBUG("commodity.prices.find", "  using last price");
-#endif
-    } else {
-      point.when = (*i).first;
-      if (*moment < point.when) {
-	if (i != prices.begin()) {
-	  --i;
-	  point.when  = (*i).first;
-	  point.price = (*i).second;
-	  found = true;
-	}
-      } else {
+    assert(i != prices.end());
+
+    point.when = (*i).first;
+    if (*moment < point.when) {
+      if (i != prices.begin()) {
+	--i;
+	point.when  = (*i).first;
 	point.price = (*i).second;
 	found = true;
       }
+    } else {
+      point.price = (*i).second;
+      found = true;
+    }
+#if defined(DEBUG_ON)
+    DEBUG_INDENT("commodity.prices.find", indent);
+    DEBUG("commodity.prices.find", "  using found price");
+#endif
+  }
+
+  foreach (const price_series_t * series, stored) {
+    optional<price_point_t> stored_point = series->find_price(moment);
+    if (stored_point && (! found || stored_point->when > point.when)) {
+      point = *stored_point;
+      found = true;
 #if defined(DEBUG_ON)
       DEBUG_INDENT("commodity.prices.find", indent);
-      DEBUG("commodity.prices.find", "  using found price");
+      DEBUG("commodity.prices.find", "  using price from price store");
 #endif
     }
   }
@@ -382,6 +392,111 @@ optional<commodity_t::base_t::history_t&>
   return none;
 }
 
+void commodity_t::add_price(const datetime_t& date, const amount_t& price,
+			    const bool reflexive)
+{
+  if (! base->varied_history)
+    base->varied_history = varied_history_t();
+
+  parent().price_added(*this, date,
+		       ! base->varied_history->history(price.commodity()));
+
+  base->varied_history->add_price(*this, date, price, reflexive);
+}
+
+bool commodity_t::remove_price(const datetime_t& date, commodity_t& commodity)
+{
+  if (base->varied_history) {
+    parent().price_removed(*this);
+
+    base->varied_history->remove_price(date, commodity);
+  }
+  return false;
+}
+
+optional<price_point_t>
+commodity_t::find_price(const optional<commodity_t&>& commodity,
+			const optional<datetime_t>&   moment,
+			const optional<datetime_t>&   oldest
+#if defined(DEBUG_ON)
+			, const int indent
+#endif
+			) const
+{
+  if (! base->varied_history || has_flags(COMMODITY_WALKED))
+    return none;
+
+  // Only a search begun outside of any other is cached, since a search
+  // within another excludes the commodities already being walked, and so
+  // may not find what it would have by itself.
+  commodity_pool_t& pool(parent());
+  optional<commodity_pool_t::price_key_t> key;
+  if (! oldest && pool.price_searches == 0) {
+    if (commodity && moment)
+      return pool.find_price(*this, *commodity, *moment);
+
+    key = commodity_pool_t::price_key_t(*this, commodity, moment);
+
+    commodity_pool_t::price_cache_map::const_iterator i =
+      pool.price_cache.find(*key);
+    if (i != pool.price_cache.end()) {
+      pool.price_cache_hits++;
+      return (*i).second;
+    }
+    pool.price_cache_misses++;
+  }
+
+  optional<price_point_t> point = search_price(commodity, moment, oldest
+#if defined(DEBUG_ON)
+					       , indent
+#endif
+					       );
+  if (key)
+    pool.price_cache.insert(commodity_pool_t::price_cache_map::value_type
+			    (*key, point));
+  return point;
+}
+
+namespace {
+  // Marks a commodity as being walked by a price search, and counts the
+  // search as open, until the search returns or throws.
+  struct walking_guard
+  {
+    commodity_t&      commodity;
+    commodity_pool_t& pool;
+
+    walking_guard(commodity_t& _commodity, commodity_pool_t& _pool)
+      : commodity(_commodity), pool(_pool) {
+      pool.price_searches++;
+      commodity.add_flags(COMMODITY_WALKED);
+    }
+    ~walking_guard() {
+      commodity.drop_flags(COMMODITY_WALKED);
+      pool.price_searches--;
+    }
+  };
+}
+
+optional<price_point_t>
+commodity_t::search_price(const optional<commodity_t&>& commodity,
+			  const optional<datetime_t>&   moment,
+			  const optional<datetime_t>&   oldest
+#if defined(DEBUG_ON)
+			  , const int indent
+#endif
+			  ) const
+{
+  assert(base->varied_history && ! has_flags(COMMODITY_WALKED));
+
+  walking_guard guard(const_cast<commodity_t&>(*this), parent());
+
+  return base->varied_history->find_price(*this, commodity, moment, oldest
+#if defined(DEBUG_ON)
+					  , indent
+#endif
+					  );
+}
+
 void commodity_t::exchange(commodity_t&	     commodity,
 			   const amount_t&   per_unit_cost,
 			   const datetime_t& moment)
@@ -856,7 +971,11 @@ bool compare_amount_commodities::operator()(const amount_t * left,
 }
 
 commodity_pool_t::commodity_pool_t()
-  : default_commodity(NULL), keep_base(false)
+  : annotated_lookups(0), annotated_hits(0), price_searches(0),
+    price_cache_hits(0), price_cache_misses(0),
+    price_table_hits(0), price_table_misses(0),
+    price_epoch(0), price_dates_epoch(std::size_t(-1)),
+    default_commodity(NULL), keep_base(false)
 {
   TRACE_CTOR(commodity_pool_t, "");
   null_commodity = create("");
@@ -951,10 +1070,16 @@ commodity_pool_t::find(const string& symbol, const annotation_t& details)
     return NULL;
 
   if (details) {
+    annotated_key_t key(comm->referent(), details, keep_base);
+    if (commodity_t * ann_comm = find(key))
+      return ann_comm;
+
     string name = make_qualified_name(*comm, details);
 
     if (commodity_t * ann_comm = find(name)) {
       assert(ann_comm->annotated && as_annotated_commodity(*ann_comm).details);
+      annotated_commodities.insert
+	(annotated_commodities_map::value_type(key, ann_comm));
       return ann_comm;
     }
     return NULL;
@@ -1014,14 +1139,215 @@ commodity_t * commodity_pool_t::find_or_create(commodity_t&	   comm,
   assert(comm);
   assert(details);
 
+  annotated_key_t key(comm.referent(), details, keep_base);
+  if (commodity_t * ann_comm = find(key))
+    return ann_comm;
+
   string name = make_qualified_name(comm, details);
   assert(! name.empty());
 
-  if (commodity_t * ann_comm = find(name)) {
+  commodity_t * ann_comm = find(name);
+  if (ann_comm)
     assert(ann_comm->annotated && as_annotated_commodity(*ann_comm).details);
-    return ann_comm;
+  else
+    ann_comm = create(comm, details, name);
+
+  annotated_commodities.insert
+    (annotated_commodities_map::value_type(key, ann_comm));
+  return ann_comm;
+}
+
+bool commodity_pool_t::price_table_t::reaches(const commodity_t& comm) const
+{
+  foreach (const commodity_t * other, reachable)
+    if (other->base == comm.base)
+      return true;
+  return false;
+}
+
+optional<datetime_t>
+commodity_pool_t::price_table_t::last_change(const datetime_t& moment) const
+{
+  optional<datetime_t> last;
+
+  std::vector<datetime_t>::const_iterator i =
+    std::upper_bound(dates.begin(), dates.end(), moment);
+  if (i != dates.begin())
+    last = *(i - 1);
+
+  foreach (const price_series_t * series, stored) {
+    optional<datetime_t> when = series->latest(moment);
+    if (when && (! last || *when > *last))
+      last = when;
+  }
+  return last;
+}
+
+optional<price_point_t>
+commodity_pool_t::find_price(const commodity_t& comm,
+			     commodity_t&	target,
+			     const datetime_t&	moment)
+{
+  // Every lot of a commodity shares the price history of the commodity
+  // itself, and so shares its table.
+  const commodity_t& source(comm.referent());
+
+  std::pair<price_tables_map::iterator, bool> result =
+    price_tables.insert(price_tables_map::value_type
+			(price_table_key(&source, &target), price_table_t()));
+  price_table_t& table((*result.first).second);
+
+  if (result.second) {
+    // Walk the graph of price histories outward from the source, and
+    // gather the dates of every price in memory a search might use, and
+    // the stored series holding the rest.  A series is attached both to
+    // the commodity it prices and, inverted, to the one it is priced in,
+    // but its dates need only be searched once.
+    std::set<const char *> series_seen;
+
+    table.reachable.push_back(&source);
+    for (std::size_t i = 0; i < table.reachable.size(); i++) {
+      const commodity_t * comm = table.reachable[i];
+      if (! comm->base->varied_history)
+	continue;
+
+      foreach (const commodity_t::history_by_commodity_map::value_type& hist,
+	       comm->base->varied_history->histories) {
+	hist.second.dates(table.dates);
+	foreach (const price_series_t * series, hist.second.stored)
+	  if (series_seen.insert(series->records).second)
+	    table.stored.push_back(series);
+
+	if (! table.reaches(*hist.first))
+	  table.reachable.push_back(hist.first);
+      }
+    }
+
+    std::sort(table.dates.begin(), table.dates.end());
+    table.dates.erase(std::unique(table.dates.begin(), table.dates.end()),
+		      table.dates.end());
+
+    DEBUG("commodity.prices.table", "Price table for " << source
+	  << " in terms of " << target << " has " << table.dates.size()
+	  << " dates and " << table.stored.size() << " stored series via "
+	  << table.reachable.size() << " commodities");
+  }
+
+  // Before the earliest date, no history has a price to offer.
+  optional<datetime_t> when = table.last_change(moment);
+  if (! when)
+    return none;
+
+  std::map<datetime_t, optional<price_point_t> >::iterator p =
+    table.points.find(*when);
+  if (p != table.points.end()) {
+    price_table_hits++;
+    return (*p).second;
+  }
+
+  price_table_misses++;
+  optional<price_point_t> point = source.search_price(target, *when, none);
+  table.points.insert(std::pair<datetime_t, optional<price_point_t> >
+		      (*when, point));
+  return point;
+}
+
+void commodity_pool_t::price_added(const commodity_t& comm,
+				   const datetime_t&  date,
+				   const bool	      new_history)
+{
+  price_epoch++;
+  price_cache.clear();
+
+  for (price_tables_map::iterator i = price_tables.begin();
+       i != price_tables.end(); ) {
+    price_table_t& table((*i).second);
+    if (! table.reaches(comm)) {
+      ++i;
+    }
+    else if (new_history) {
+      // The graph itself has changed, and this table may now reach
+      // commodities it did not before.
+      i = price_tables.erase(i);
+    }
+    else {
+      std::vector<datetime_t>::iterator d =
+	std::lower_bound(table.dates.begin(), table.dates.end(), date);
+      if (d == table.dates.end() || *d != date)
+	table.dates.insert(d, date);
+      table.points.erase(table.points.lower_bound(date), table.points.end());
+      ++i;
+    }
+  }
+}
+
+void commodity_pool_t::price_removed(const commodity_t& comm)
+{
+  price_epoch++;
+  price_cache.clear();
+
+  for (price_tables_map::iterator i = price_tables.begin();
+       i != price_tables.end(); ) {
+    if ((*i).second.reaches(comm))
+      i = price_tables.erase(i);
+    else
+      ++i;
+  }
+}
+
+bool commodity_pool_t::prices_between(const datetime_t& from,
+				      const datetime_t& to)
+{
+  if (price_dates_epoch != price_epoch) {
+    price_dates.clear();
+    price_series.clear();
+    foreach (const commodities_map::value_type& pair, commodities) {
+      const commodity_t& comm(*pair.second);
+      if (comm.annotated || ! comm.base->varied_history)
+	continue;
+
+      foreach (const commodity_t::history_by_commodity_map::value_type& hist,
+	       comm.base->varied_history->histories) {
+	hist.second.dates(price_dates);
+
+	// Each stored series is also attached inverted, with the same
+	// dates, to the commodity it is priced in.
+	foreach (const price_series_t * series, hist.second.stored)
+	  if (! series->inverse)
+	    price_series.push_back(series);
+      }
+    }
+    std::sort(price_dates.begin(), price_dates.end());
+    price_dates.erase(std::unique(price_dates.begin(), price_dates.end()),
+		      price_dates.end());
+
+    price_dates_epoch = price_epoch;
+  }
+
+  // Is there a price recorded in the interval (from, to]?
+  std::vector<datetime_t>::const_iterator i =
+    std::upper_bound(price_dates.begin(), price_dates.end(), from);
+  if (i != price_dates.end() && *i <= to)
+    return true;
+
+  foreach (const price_series_t * series, price_series) {
+    optional<datetime_t> when = series->latest(to);
+    if (when && *when > from)
+      return true;
+  }
+  return false;
+}
+
+commodity_t * commodity_pool_t::find(const annotated_key_t& key)
+{
+  annotated_lookups++;
+
+  annotated_commodities_map::const_iterator i = annotated_commodities.find(key);
+  if (i != annotated_commodities.end()) {
+    annotated_hits++;
+    return (*i).second;
   }
-  return create(comm, details, name);
+  return NULL;
 }
 
 void commodity_pool_t::parse_commodity_price(char * optarg)
@@ -1041,4 +1367,49 @@ void commodity_pool_t::parse_commodity_price(char * optarg)
     commodity->add_price(CURRENT_TIME(), price);
 }
 
+commodity_t *
+commodity_pool_t::parse_price_directive(char *	    line,
+					datetime_t& moment,
+					amount_t&   price,
+					int	    current_year)
+{
+  assert(amount_t::current_pool.get() == this);
+
+  char * date_field_ptr = skip_ws(line);
+  char * time_field_ptr = next_element(date_field_ptr);
+  if (! time_field_ptr) return NULL;
+  string date_field = date_field_ptr;
+
+  char * symbol_and_price;
+
+  if (std::isdigit(time_field_ptr[0])) {
+    symbol_and_price = next_element(time_field_ptr);
+    if (! symbol_and_price) return NULL;
+    moment = parse_datetime(date_field + " " + time_field_ptr, current_year);
+  } else {
+    symbol_and_price = time_field_ptr;
+    moment = parse_datetime(date_field, current_year);
+  }
+
+  string symbol;
+  commodity_t::parse_symbol(symbol_and_price, symbol);
+  price.parse(symbol_and_price);
+  VERIFY(price.valid());
+
+  return find_or_create(symbol);
+}
+
+void commodity_pool_t::log_statistics() const
+{
+  INFO("Annotated commodity lookups: " << annotated_lookups << ", "
+       << annotated_hits << " found by their details ("
+       << (annotated_lookups ? (annotated_hits * 100) / annotated_lookups : 0)
+       << "%)");
+  INFO("Price searches: " << price_cache_hits << " cached, "
+       << price_cache_misses << " searched");
+  INFO("Price table lookups: " << price_table_hits << " found, "
+       << price_table_misses << " searched, in "
+       << price_tables.size() << " tables");
+}
+
 } // namespace ledger
@@ -50,6 +50,8 @@
 namespace ledger {
 
 class keep_details_t;
+struct price_series_t;
+class price_store_t;
 
 DECLARE_EXCEPTION(commodity_error, std::runtime_error);
 
@@ -81,12 +83,112 @@ public:
     base_t();
 
   public:
-    typedef std::map<const datetime_t, amount_t> history_map;
+    /**
+     * @class history_map
+     *
+     * @brief The prices of a commodity, ordered by date.
+     *
+     * A price history may hold a price for every day of many years, and
+     * market valuations search it for every posting.  The prices are
+     * therefore kept in a vector sorted by date, which is searched by
+     * bisection.  Prices are nearly always added in date order, which
+     * only appends to the vector; an earlier price is inserted in its
+     * place.  The interface is the subset of std::map used on histories.
+     */
+    class history_map
+    {
+    public:
+      typedef datetime_t			      key_type;
+      typedef std::pair<datetime_t, amount_t>	      value_type;
+      typedef std::vector<value_type>		      prices_vector;
+      typedef prices_vector::iterator		      iterator;
+      typedef prices_vector::const_iterator	      const_iterator;
+      typedef prices_vector::const_reverse_iterator const_reverse_iterator;
+      typedef prices_vector::size_type		      size_type;
+
+    private:
+      prices_vector prices;
+
+      struct key_less {
+	bool operator()(const value_type& price, const key_type& when) const {
+	  return price.first < when;
+	}
+      };
+
+    public:
+      iterator begin() {
+	return prices.begin();
+      }
+      iterator end() {
+	return prices.end();
+      }
+      const_iterator begin() const {
+	return prices.begin();
+      }
+      const_iterator end() const {
+	return prices.end();
+      }
+      const_reverse_iterator rbegin() const {
+	return prices.rbegin();
+      }
+      const_reverse_iterator rend() const {
+	return prices.rend();
+      }
+
+      size_type size() const {
+	return prices.size();
+      }
+      bool empty() const {
+	return prices.empty();
+      }
+      const value_type& back() const {
+	return prices.back();
+      }
+
+      iterator lower_bound(const key_type& when) {
+	return std::lower_bound(prices.begin(), prices.end(), when, key_less());
+      }
+      const_iterator lower_bound(const key_type& when) const {
+	return std::lower_bound(prices.begin(), prices.end(), when, key_less());
+      }
+
+      iterator find(const key_type& when) {
+	iterator i = lower_bound(when);
+	return (i != end() && (*i).first == when) ? i : end();
+      }
+
+      std::pair<iterator, bool> insert(const value_type& price) {
+	if (prices.empty() || prices.back().first < price.first) {
+	  prices.push_back(price);
+	  return std::pair<iterator, bool>(prices.end() - 1, true);
+	}
+	iterator i = lower_bound(price.first);
+	if ((*i).first == price.first)
+	  return std::pair<iterator, bool>(i, false);
+	return std::pair<iterator, bool>(prices.insert(i, price), true);
+      }
+
+      size_type erase(const key_type& when) {
+	iterator i = find(when);
+	if (i == end())
+	  return 0;
+	prices.erase(i);
+	return 1;
+      }
+    };
 
+    /**
+     * A history's prices may also be kept in a price store, in which
+     * case `stored' refers to them there; they are only read from it when
+     * a search reaches them.  dates() gives only those in `prices'.
+     */
     struct history_t
     {
-      history_map prices;
-      ptime	  last_lookup;
+      history_map			    prices;
+      std::vector<const price_series_t *> stored;
+      ptime				    last_lookup;
+
+      void dates(std::vector<datetime_t>& into) const;
 
       void add_price(commodity_t&	source,
 		     const datetime_t&	date,
@@ -276,17 +378,8 @@ public:
   // base->varied_history object.
 
   void add_price(const datetime_t& date, const amount_t& price,
-		 const bool reflexive = true) {
-    if (! base->varied_history)
-      base->varied_history = varied_history_t();
-
-    base->varied_history->add_price(*this, date, price, reflexive);
-  }
-  bool remove_price(const datetime_t& date, commodity_t& commodity) {
-    if (base->varied_history)
-      base->varied_history->remove_price(date, commodity);
-    return false;
-  }
+		 const bool reflexive = true);
+  bool remove_price(const datetime_t& date, commodity_t& commodity);
 
   optional<price_point_t>
   find_price(const optional<commodity_t&>& commodity = none,
@@ -295,21 +388,19 @@ public:
 #if defined(DEBUG_ON)
 	     , const int indent = 0
 #endif
-	     ) const {
-    if (base->varied_history && ! has_flags(COMMODITY_WALKED)) {
-      const_cast<commodity_t&>(*this).add_flags(COMMODITY_WALKED);
-      optional<price_point_t> point =
-	base->varied_history->find_price(*this, commodity, moment, oldest
+	     ) const;
+
+private:
+  optional<price_point_t>
+  search_price(const optional<commodity_t&>& commodity,
+	       const optional<datetime_t>&   moment,
+	       const optional<datetime_t>&   oldest
 #if defined(DEBUG_ON)
-					 , indent
+	       , const int indent = 0
 #endif
-					 );
-      const_cast<commodity_t&>(*this).drop_flags(COMMODITY_WALKED);
-      return point;
-    }
-    return none;
-  }    
+	       ) const;
 
+public:
   // Methods to exchange one commodity for another, while recording the
   // factored price.
 
@@ -453,6 +544,17 @@ inline std::ostream& operator<<(std::ostream&       out,
   return out;
 }
 
+inline std::size_t hash_value(const annotation_t& details) {
+  std::size_t seed = 0;
+  if (details.price)
+    boost::hash_combine(seed, *details.price);
+  if (details.date)
+    boost::hash_combine(seed, details.date->julian_day());
+  if (details.tag)
+    boost::hash_combine(seed, *details.tag);
+  return seed;
+}
+
 /**
  * @brief Brief
  *
@@ -520,16 +622,157 @@ struct compare_amount_commodities {
  */
 class commodity_pool_t : public noncopyable
 {
+public:
   /**
    * The commodities collection in commodity_pool_t maintains pointers to all
    * the commodities which have ever been created by the user, whether
    * explicitly by calling the create methods of commodity_pool_t, or
    * implicitly by parsing a commoditized amount.
    */
-  typedef std::map<string, commodity_t *> commodities_map;
+  typedef boost::unordered_map<string, commodity_t *> commodities_map;
 
-public:
-  commodities_map commodities;
+  /**
+   * Annotated commodities are keyed in `commodities' by the printed form
+   * of their annotation.  Printing an annotation is costly, and journals
+   * of lots look one up for nearly every posting, so each annotated
+   * commodity found is also remembered under the commodity it annotates
+   * and the details themselves.
+   */
+  struct annotated_key_t : public equality_comparable<annotated_key_t>
+  {
+    const commodity_t * referent;
+    annotation_t	details;
+    bool		keep_base;
+
+    annotated_key_t(const commodity_t&	_referent,
+		    const annotation_t& _details,
+		    const bool		_keep_base)
+      : referent(&_referent), details(_details), keep_base(_keep_base) {}
+
+    bool operator==(const annotated_key_t& rhs) const {
+      return (referent == rhs.referent && keep_base == rhs.keep_base &&
+	      details == rhs.details &&
+	      (details.has_flags(ANNOTATION_PRICE_FIXATED) ==
+	       rhs.details.has_flags(ANNOTATION_PRICE_FIXATED)));
+    }
+
+    friend std::size_t hash_value(const annotated_key_t& key) {
+      std::size_t seed = 0;
+      boost::hash_combine(seed, key.referent);
+      boost::hash_combine(seed, key.details);
+      boost::hash_combine(seed, key.details.has_flags(ANNOTATION_PRICE_FIXATED));
+      boost::hash_combine(seed, key.keep_base);
+      return seed;
+    }
+  };
+
+  typedef boost::unordered_map<annotated_key_t, commodity_t *>
+    annotated_commodities_map;
+
+  commodities_map	    commodities;
+  annotated_commodities_map annotated_commodities;
+
+  std::size_t annotated_lookups;
+  std::size_t annotated_hits;
+
+  /**
+   * Finding the price of a commodity in terms of another may search
+   * through the price histories of many other commodities, and reports
+   * do this again for every posting valued at the same moment.  The
+   * outcome of each search begun by commodity_t::find_price is kept here
+   * until a price is next added to or removed from any history.
+   */
+  struct price_key_t : public equality_comparable<price_key_t>
+  {
+    const commodity_t *	 source;
+    const commodity_t *	 target;
+    optional<datetime_t> moment;
+
+    price_key_t(const commodity_t&		  _source,
+		const optional<commodity_t&>& _target,
+		const optional<datetime_t>&   _moment)
+      : source(&_source), target(_target ? &*_target : NULL),
+	moment(_moment) {}
+
+    bool operator==(const price_key_t& rhs) const {
+      return (source == rhs.source && target == rhs.target &&
+	      moment == rhs.moment);
+    }
+
+    friend std::size_t hash_value(const price_key_t& key) {
+      std::size_t seed = 0;
+      boost::hash_combine(seed, key.source);
+      boost::hash_combine(seed, key.target);
+      if (key.moment) {
+	boost::hash_combine(seed, key.moment->date().julian_day());
+	boost::hash_combine(seed, key.moment->time_of_day().ticks());
+      }
+      return seed;
+    }
+  };
+
+  typedef boost::unordered_map<price_key_t, optional<price_point_t> >
+    price_cache_map;
+
+  price_cache_map price_cache;
+  int		  price_searches;  // number of find_price calls under way
+
+  std::size_t price_cache_hits;
+  std::size_t price_cache_misses;
+
+  /**
+   * The prices of all commodities form a graph, whose edges are the
+   * price histories each commodity keeps in terms of others.  The price
+   * of a source commodity in terms of a target, such as the one given to
+   * -X, can only change on a date for which some history reachable from
+   * the source records a price.  A price table keeps the dates of those
+   * histories' prices held in memory, and the series of those held in a
+   * price store, which it only bisects, so that valuing an amount at any
+   * moment finds the last such date before it.  The price found as of
+   * that date is kept once it has been asked for.  The lots of a
+   * commodity share its history, and so share its table.
+   *
+   * Tables follow the histories as prices are added.  A price added to
+   * an existing history only adds its date to the tables that reach it
+   * and forgets the prices found on or after that date.  A history newly
+   * begun, or a price removed, discards the tables that reach it.
+   */
+  struct price_table_t
+  {
+    std::vector<const commodity_t *>		   reachable;
+    std::vector<datetime_t>			   dates;
+    std::vector<const price_series_t *>	   stored;
+    std::map<datetime_t, optional<price_point_t> > points;
+
+    bool reaches(const commodity_t& comm) const;
+
+    optional<datetime_t> last_change(const datetime_t& moment) const;
+  };
+
+  typedef std::pair<const commodity_t *, const commodity_t *> price_table_key;
+  typedef boost::unordered_map<price_table_key, price_table_t>
+    price_tables_map;
+
+  price_tables_map price_tables;
+
+  std::size_t price_table_hits;
+  std::size_t price_table_misses;
+
+  /**
+   * `price_epoch' counts the prices added to or removed from any history,
+   * so that values computed from prices may be kept until it changes.
+   * `price_dates' holds the dates of all prices held in memory, in
+   * order, and `price_series' every series held in a price store; both
+   * are gathered again whenever the epoch has moved on.
+   */
+  std::size_t				price_epoch;
+  std::vector<datetime_t>		price_dates;
+  std::vector<const price_series_t *> price_series;
+  std::size_t				price_dates_epoch;
+
+  // The store, if any, whose prices the histories refer to (see
+  // pricedb.h).  The pool keeps it open for as long as they do.
+  shared_ptr<price_store_t> price_store;
 
   commodity_t *	null_commodity;
   commodity_t *	default_commodity;
@@ -567,7 +810,32 @@ public:
   commodity_t * find_or_create(commodity_t&	   comm,
 			       const annotation_t& details);
 
+  commodity_t * find(const annotated_key_t& key);
+
+  optional<price_point_t> find_price(const commodity_t& source,
+				     commodity_t&	target,
+				     const datetime_t&	moment);
+
+  void price_added(const commodity_t& comm, const datetime_t& date,
+		   const bool new_history);
+  void price_removed(const commodity_t& comm);
+
+  bool prices_between(const datetime_t& from, const datetime_t& to);
+
   void parse_commodity_price(char * optarg);
+
+  /**
+   * Read the body of a P directive, everything after its P, as the
+   * moment and the price it gives.  The price is read in the current
+   * pool, which should be this one.  Returns the commodity priced, or
+   * NULL if the directive gives no price.
+   */
+  commodity_t * parse_price_directive(char *	  line,
+				      datetime_t& moment,
+				      amount_t&	  price,
+				      int	  current_year = -1);
+
+  void log_statistics() const;
 };
 
 } // namespace ledger
@@ -33,6 +33,7 @@
 
 #include "expr.h"
 #include "parser.h"
+#include "bytecode.h"
 
 namespace ledger {
 
@@ -85,6 +86,7 @@ expr_t& expr_t::operator=(const expr_t& _expr)
     ptr	     = _expr.ptr;
     context  = _expr.context;
     compiled = _expr.compiled;
+    code     = _expr.code;
   }
   return *this;
 }
@@ -97,6 +99,7 @@ void expr_t::parse(const string& _str, const uint32_t flags)
 			  (static_cast<uint_least8_t>(flags)));
   context  = NULL;
   compiled = false;
+  code.reset();
 }
 
 void expr_t::parse(std::istream& in, const uint32_t flags,
@@ -108,6 +111,7 @@ void expr_t::parse(std::istream& in, const uint32_t flags,
 			  (static_cast<uint_least8_t>(flags)), original_string);
   context  = NULL;
   compiled = false;
+  code.reset();
 }
 
 void expr_t::recompile(scope_t& scope)
@@ -116,6 +120,7 @@ void expr_t::recompile(scope_t& scope)
     ptr	     = ptr->compile(scope);
     context  = &scope;
     compiled = true;
+    code.reset();
   }
 }
 
@@ -144,7 +149,15 @@ value_t expr_t::calc(scope_t& scope)
 
     ptr_op_t locus;
     try {
-      return ptr->calc(scope, &locus);
+      // The tree evaluator is kept for debugging, since it reports each
+      // node it calculates; otherwise the compiled tree is lowered to
+      // bytecode the first time it is needed.
+      if (SHOW_DEBUG("expr.calc"))
+	return ptr->calc(scope, &locus);
+
+      if (! code)
+	code.reset(new bytecode_t(ptr));
+      return code->run(scope, &locus);
     }
     catch (const std::exception& err) {
       if (locus) {
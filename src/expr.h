@@ -74,6 +74,7 @@ class expr_t
 
 public:
   class op_t;
+  class bytecode_t;
   typedef intrusive_ptr<op_t>	    ptr_op_t;
   typedef intrusive_ptr<const op_t> const_ptr_op_t;
 
@@ -94,6 +95,8 @@ private:
   string    str;
   bool	    compiled;
 
+  shared_ptr<bytecode_t> code;
+
 public:
   expr_t();
   expr_t(const expr_t& other);
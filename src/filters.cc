@@ -390,6 +390,26 @@ void related_posts::flush()
 
 void changed_value_posts::output_revaluation(post_t * post, const date_t& date)
 {
+  // The revalued total of the last posting only differs from the total
+  // computed for it when it was seen if some price was recorded between
+  // that posting's date and this one.  Otherwise there is nothing to
+  // revalue, and the total need not be computed again.
+  if (! last_total.is_null() &&
+      last_total_epoch == amount_t::current_pool->price_epoch) {
+    date_t when  = post->date();
+    date_t until = is_valid(date) ? date : when;
+    if (until < when)
+      std::swap(when, until);
+
+    if (! amount_t::current_pool->prices_between
+	(datetime_t(when, time_duration(0, 0, 0, 0)),
+	 datetime_t(until + gregorian::days(1), time_duration(0, 0, 0, 0)))) {
+      DEBUG("filter.changed_value",
+	    "output_revaluation: no prices moved since " << when);
+      return;
+    }
+  }
+
   if (is_valid(date))
     post->xdata().date = date;
 
@@ -478,7 +498,8 @@ void changed_value_posts::operator()(post_t& post)
   item_handler<post_t>::operator()(post);
 
   bind_scope_t bound_scope(report, post);
-  last_total = total_expr.calc(bound_scope);
+  last_total	   = total_expr.calc(bound_scope);
+  last_total_epoch = amount_t::current_pool->price_epoch;
 
   last_post = &post;
 }
@@ -660,7 +681,13 @@ void posts_as_equity::report_subtotal()
 
 void by_payee_posts::flush()
 {
-  foreach (payee_subtotals_map::value_type& pair, payee_subtotals)
+  // Payees are looked up by their interned handles, but reported in the
+  // order of their names, which is how interned_t sorts.
+  std::vector<payee_subtotals_pair> sorted(payee_subtotals.begin(),
+					   payee_subtotals.end());
+  std::sort(sorted.begin(), sorted.end());
+
+  foreach (payee_subtotals_pair& pair, sorted)
     pair.second->report_subtotal(pair.first.c_str());
 
   item_handler<post_t>::flush();
@@ -438,6 +438,7 @@ class changed_value_posts : public item_handler<post_t>
   bool	    changed_values_only;
   post_t *  last_post;
   value_t   last_total;
+  std::size_t last_total_epoch;
   value_t   last_display_total;
   account_t revalued_account;
   account_t rounding_account;
@@ -458,7 +459,7 @@ public:
       display_amount_expr(_display_amount_expr), total_expr(_total_expr),
       display_total_expr(_display_total_expr), report(_report),
       changed_values_only(_changed_values_only), last_post(NULL),
-      revalued_account(NULL, _("<Revalued>")),
+      last_total_epoch(0), revalued_account(NULL, _("<Revalued>")),
       rounding_account(NULL, _("<Rounding>")){
     TRACE_CTOR(changed_value_posts,
 	       "post_handler_ptr, const expr_t&, const expr_t&, report_t&, bool");
@@ -630,8 +631,10 @@ public:
  */
 class by_payee_posts : public item_handler<post_t>
 {
-  typedef std::map<string, shared_ptr<subtotal_posts> >  payee_subtotals_map;
-  typedef std::pair<string, shared_ptr<subtotal_posts> > payee_subtotals_pair;
+  typedef boost::unordered_map<interned_t, shared_ptr<subtotal_posts> >
+    payee_subtotals_map;
+  typedef std::pair<interned_t, shared_ptr<subtotal_posts> >
+    payee_subtotals_pair;
 
   expr_t&	      amount_expr;
   payee_subtotals_map payee_subtotals;
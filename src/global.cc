@@ -215,6 +215,11 @@ void global_scope_t::execute_command(strings_list args, bool at_repl)
   INFO_START(command, "Finished executing command");
   command(command_args);
   INFO_FINISH(command);
+
+  IF_INFO() {
+    amount_t::log_statistics();
+    amount_t::current_pool->log_statistics();
+  }
 }
 
 int global_scope_t::execute_command_wrapper(strings_list args, bool at_repl)
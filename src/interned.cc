@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2003-2009, John Wiegley.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * - Neither the name of New Artisans LLC nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <system.hh>
+
+#include "interned.h"
+
+namespace ledger {
+
+namespace {
+  typedef std::set<string> interned_set;
+
+  // The table is made on first use, since handles may be created by
+  // static initializers.
+  interned_set * interned_strings = NULL;
+}
+
+const string * interned_t::intern(const string& str)
+{
+  if (str.empty())
+    return NULL;
+
+  if (! interned_strings)
+    interned_strings = new interned_set;
+
+  return &*interned_strings->insert(str).first;
+}
+
+optional<interned_t> interned_t::find(const string& str)
+{
+  interned_t result;
+  if (! str.empty()) {
+    if (! interned_strings)
+      return none;
+
+    interned_set::const_iterator i = interned_strings->find(str);
+    if (i == interned_strings->end())
+      return none;
+    result.text = &*i;
+  }
+  return result;
+}
+
+void interned_t::shutdown()
+{
+  checked_delete(interned_strings);
+  interned_strings = NULL;
+}
+
+} // namespace ledger
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2003-2009, John Wiegley.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * - Neither the name of New Artisans LLC nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @addtogroup util
+ */
+
+/**
+ * @file   interned.h
+ * @author John Wiegley
+ *
+ * @ingroup util
+ *
+ * @brief Strings kept once, and referred to by pointer.
+ *
+ * A journal repeats the same few thousand payees, and the same few tag
+ * names, across a great many transactions and postings.  Rather than
+ * each of these holding its own copy of the text, they hold a pointer to
+ * the single copy kept in a table of interned strings.
+ */
+#ifndef _INTERNED_H
+#define _INTERNED_H
+
+#include "utils.h"
+
+namespace ledger {
+
+/**
+ * @brief A handle to an interned string
+ *
+ * Two handles are equal exactly when they point to the same copy, so
+ * comparing them for equality is a pointer comparison.  They order as
+ * their text does.  The empty string is represented by a null pointer
+ * and is never entered into the table.
+ */
+class interned_t
+{
+  const string * text;
+
+  static const string * intern(const string& str);
+
+public:
+  interned_t() : text(NULL) {}
+  interned_t(const string& str) : text(intern(str)) {}
+  interned_t(const char * str) : text(intern(string(str))) {}
+#if defined(VERIFY_ON)
+  interned_t(const std::string& str) : text(intern(string(str))) {}
+#endif
+
+  // Return the handle for `str' if it has already been interned, without
+  // interning it otherwise; nothing holds such a string, so a caller
+  // searching for it need look no further.
+  static optional<interned_t> find(const string& str);
+
+  // Free the table, once nothing refers to it any longer.
+  static void shutdown();
+
+  const string& str() const {
+    return text ? *text : empty_string;
+  }
+  operator const string&() const {
+    return str();
+  }
+  const char * c_str() const {
+    return str().c_str();
+  }
+  bool empty() const {
+    return text == NULL;
+  }
+
+  bool operator==(const interned_t& other) const {
+    return text == other.text;
+  }
+  bool operator!=(const interned_t& other) const {
+    return text != other.text;
+  }
+  bool operator<(const interned_t& other) const {
+    return text != other.text && str() < other.str();
+  }
+
+  // Equal handles share a pointer, so hashing the pointer is enough.
+  friend std::size_t hash_value(const interned_t& str) {
+    return boost::hash_value(str.text);
+  }
+};
+
+inline std::ostream& operator<<(std::ostream& out, const interned_t& str) {
+  out << str.str();
+  return out;
+}
+
+} // namespace ledger
+
+#endif // _INTERNED_H
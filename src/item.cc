@@ -44,7 +44,13 @@ bool item_t::has_tag(const string& tag) const
     DEBUG("item.meta", "Item has no metadata at all");
     return false;
   }
-  string_map::const_iterator i = metadata->find(tag);
+  // A tag name never interned is one that no item has.
+  optional<interned_t> key = interned_t::find(tag);
+  if (! key) {
+    DEBUG("item.meta", "No item has this tag");
+    return false;
+  }
+  string_map::const_iterator i = metadata->find(*key);
 #if defined(DEBUG_ON)
   if (SHOW_DEBUG("item.meta")) {
     if (i == metadata->end())
@@ -77,10 +83,12 @@ optional<string> item_t::get_tag(const string& tag) const
   DEBUG("item.meta", "Getting item tag: " << tag);
   if (metadata) {
     DEBUG("item.meta", "Item has metadata");
-    string_map::const_iterator i = metadata->find(tag);
-    if (i != metadata->end()) {
-      DEBUG("item.meta", "Found the item!");
-      return (*i).second;
+    if (optional<interned_t> key = interned_t::find(tag)) {
+      string_map::const_iterator i = metadata->find(*key);
+      if (i != metadata->end()) {
+	DEBUG("item.meta", "Found the item!");
+	return (*i).second;
+      }
     }
   }
   return none;
@@ -116,18 +124,17 @@ void item_t::set_tag(const string&           tag,
 
 void item_t::parse_tags(const char * p, int current_year)
 {
-  if (char * b = std::strchr(p, '[')) {
-    if (char * e = std::strchr(p, ']')) {
-      char buf[256];
-      std::strncpy(buf, b + 1, e - b - 1);
-      buf[e - b - 1] = '\0';
-
-      if (char * p = std::strchr(buf, '=')) {
-	*p++ = '\0';
-	_date_eff = parse_date(p, current_year);
+  if (const char * b = std::strchr(p, '[')) {
+    if (const char * e = std::strchr(b, ']')) {
+      string dates(b + 1, e);
+
+      string::size_type eq = dates.find('=');
+      if (eq != string::npos) {
+	_date_eff = parse_date(dates.substr(eq + 1), current_year);
+	dates.erase(eq);
       }
-      if (buf[0])
-	_date = parse_date(buf, current_year);
+      if (! dates.empty())
+	_date = parse_date(dates, current_year);
     }
   }
 
@@ -372,6 +379,12 @@ expr_t::ptr_op_t item_t::lookup(const string& name)
   return NULL;
 }
 
+dispatch_table_t * item_t::dispatch_table()
+{
+  static dispatch_table_t table;
+  return &table;
+}
+
 bool item_t::valid() const
 {
   if (_state != UNCLEARED && _state != CLEARED && _state != PENDING) {
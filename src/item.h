@@ -47,6 +47,7 @@
 #define _ITEM_H
 
 #include "scope.h"
+#include "interned.h"
 
 namespace ledger {
 
@@ -70,7 +71,7 @@ public:
   optional<date_t>   _date_eff;
   optional<string>   note;
 
-  typedef std::map<string, optional<string> > string_map;
+  typedef std::map<interned_t, optional<string> > string_map;
   optional<string_map> metadata;
 
   path               pathname;
@@ -153,6 +154,7 @@ public:
   }
 
   virtual expr_t::ptr_op_t lookup(const string& name);
+  virtual dispatch_table_t * dispatch_table();
 
   bool valid() const;
 };
@@ -34,9 +34,20 @@
 #include "iterators.h"
 #include "journal.h"
 #include "compare.h"
+#include "pricedb.h"
 
 namespace ledger {
 
+namespace {
+  struct price_date_less
+  {
+    bool operator()(const commodity_t::history_map::value_type& left,
+		    const commodity_t::history_map::value_type& right) const {
+      return left.first < right.first;
+    }
+  };
+}
+
 void xacts_iterator::reset(journal_t& journal)
 {
   xacts_i   = journal.xacts.begin();
@@ -98,8 +109,19 @@ void posts_commodities_iterator::reset(journal_t& journal)
 
     foreach (commodity_t::base_t::history_by_commodity_map::value_type pair,
 	     history->histories) {
-      foreach (commodity_t::base_t::history_map::value_type hpair,
-	       pair.second.prices) {
+      // Prices kept in the price store are only read out of it now, and
+      // merged by date with those read as text.
+      std::vector<commodity_t::history_map::value_type>
+	prices(pair.second.prices.begin(), pair.second.prices.end());
+      if (! pair.second.stored.empty()) {
+	foreach (const price_series_t * series, pair.second.stored)
+	  for (std::size_t i = 0; i < series->count; i++)
+	    prices.push_back(commodity_t::history_map::value_type
+			     (series->when(i), series->price(i)));
+	std::stable_sort(prices.begin(), prices.end(), price_date_less());
+      }
+
+      foreach (commodity_t::base_t::history_map::value_type hpair, prices) {
 	xact_t * xact;
 	string    symbol = hpair.second.commodity().symbol();
 
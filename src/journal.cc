@@ -74,6 +74,18 @@ account_t * journal_t::find_account_re(const string& regexp)
   return master->find_account_re(regexp);
 }
 
+journal_t::fileinfo_t * journal_t::record_source(const path& pathname)
+{
+  // Only a regular file can be checked for changes later on; what was
+  // read from anything else cannot be cached.
+  if (! is_regular_file(pathname)) {
+    cacheable = false;
+    return NULL;
+  }
+  sources.push_back(fileinfo_t(pathname));
+  return &sources.back();
+}
+
 bool journal_t::add_xact(xact_t * xact)
 {
   xact->journal = this;
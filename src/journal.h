@@ -72,6 +72,41 @@ typedef std::list<period_xact_t *> period_xacts_list;
 class journal_t : public noncopyable
 {
 public:
+  /**
+   * The identity of a file read into the journal, as of the time it was
+   * read, so that a cached copy of the journal can later tell whether
+   * that file has since changed, and a long-lived session whether it has
+   * merely grown.
+   */
+  struct fileinfo_t
+  {
+    path	   filename;
+    uintmax_t	   size;
+    std::time_t	   modtime;
+    uint_least32_t checksum;	// of the first `size' bytes, once parsed
+
+    // Set for a file parsed at the top level if its parse ended with no
+    // account, tag, alias or year directive still in force, so that text
+    // appended to it later can be parsed on its own; `auto_xacts' says
+    // whether automated transactions were being applied at that point.
+    bool	   appendable;
+    bool	   auto_xacts;
+
+    fileinfo_t()
+      : size(0), modtime(0), checksum(0),
+	appendable(false), auto_xacts(false) {}
+    explicit fileinfo_t(const path& _filename)
+      : filename(_filename), size(file_size(_filename)),
+	modtime(last_write_time(_filename)), checksum(0),
+	appendable(false), auto_xacts(false) {}
+
+    bool changed() const {
+      return (! is_regular_file(filename) ||
+	      file_size(filename) != size ||
+	      last_write_time(filename) != modtime);
+    }
+  };
+
   account_t * master;
   account_t * basket;
   xacts_list  xacts;
@@ -79,9 +114,18 @@ public:
   auto_xacts_list   auto_xacts;
   period_xacts_list period_xacts;
 
+  std::list<fileinfo_t> sources;
+
+  // False once anything has been read whose effects reach beyond the
+  // journal itself -- option settings, value definitions, or timelog
+  // entries left open and closed out at the current time -- since a
+  // cached copy of the journal could not reproduce them.
+  bool cacheable;
+
   hooks_t<xact_finalizer_t, xact_t> xact_finalize_hooks;
 
-  journal_t(account_t * _master = NULL) : master(_master) {
+  journal_t(account_t * _master = NULL)
+    : master(_master), basket(NULL), cacheable(true) {
     TRACE_CTOR(journal_t, "");
   }
   ~journal_t();
@@ -93,6 +137,10 @@ public:
   account_t * find_account(const string& name, bool auto_create = true);
   account_t * find_account_re(const string& regexp);
 
+  // Note a file as one the journal's contents were read from.  Returns
+  // the record made of it, or NULL if it is not a regular file.
+  fileinfo_t * record_source(const path& pathname);
+
   bool add_xact(xact_t * xact);
   bool remove_xact(xact_t * xact);
 
@@ -108,6 +156,21 @@ public:
 		    account_t *   master	= NULL,
 		    const path *  original_file = NULL,
 		    bool          strict	= false);
+  std::size_t parse(const path&  pathname,
+		    scope_t&      session_scope,
+		    account_t *   master	= NULL,
+		    bool          strict	= false);
+
+  // Parse only what has been added to the end of a file since it was
+  // last read, picking up where that parse left off.  Returns false,
+  // having read nothing, if the file has changed in any other way.  If
+  // the new text has errors, `info' is left as it was and the error is
+  // thrown; the journal may then hold some of the new transactions, and
+  // must be read again in full.
+  bool parse_appended(fileinfo_t&  info,
+		      scope_t&     session_scope,
+		      account_t *  master = NULL,
+		      bool         strict = false);
 
   bool valid() const;
 };
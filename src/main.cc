@@ -34,6 +34,7 @@
 #include "global.h"		// This is where the meat of main() is, which
 				// was moved there for the sake of clarity here
 #include "session.h"
+#include "interned.h"
 
 using namespace ledger;
 
@@ -209,6 +210,7 @@ int main(int argc, char * argv[], char * envp[])
   // leak because we're about to exit anyway.
   IF_VERIFY() {
     global_scope.reset();
+    interned_t::shutdown();
 
     INFO("Ledger ended (Boost/libstdc++ may still hold memory)");
 #if defined(VERIFY_ON)
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2003-2009, John Wiegley.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * - Neither the name of New Artisans LLC nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <system.hh>
+
+#include "mapped.h"
+
+namespace ledger {
+
+bool mapped_file_t::open(const path& pathname, const bool sequential)
+{
+  close();
+
+#if defined(HAVE_MMAP)
+  int fd = ::open(pathname.string().c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat info;
+  if (::fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+    void * addr = ::mmap(NULL, static_cast<std::size_t>(info.st_size),
+			 PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (addr != MAP_FAILED) {
+      data = static_cast<char *>(addr);
+      size = static_cast<std::size_t>(info.st_size);
+      // The parser reads straight through the file once.  Say so, and
+      // have the whole file read in now, so that for large journals the
+      // disk reads proceed while earlier parts are being parsed, rather
+      // than one page fault at a time.
+      if (sequential) {
+#if defined(MADV_SEQUENTIAL)
+	::madvise(addr, size, MADV_SEQUENTIAL);
+#endif
+#if defined(MADV_WILLNEED)
+	::madvise(addr, size, MADV_WILLNEED);
+#endif
+      } else {
+#if defined(MADV_RANDOM)
+	::madvise(addr, size, MADV_RANDOM);
+#endif
+      }
+    }
+  }
+  ::close(fd);
+
+  DEBUG("mapped.open", "Mapping '" << pathname.string() << "' "
+	<< (data ? "succeeded" : "failed") << ", " << size << " bytes");
+#endif // HAVE_MMAP
+
+  return data != NULL;
+}
+
+void mapped_file_t::close()
+{
+#if defined(HAVE_MMAP)
+  if (data)
+    ::munmap(data, size);
+#endif
+  data = NULL;
+  size = 0;
+}
+
+void prefetch_file(const path& pathname)
+{
+#if defined(HAVE_POSIX_FADVISE)
+  int fd = ::open(pathname.string().c_str(), O_RDONLY);
+  if (fd < 0)
+    return;
+
+  ::posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+  ::close(fd);
+
+  DEBUG("mapped.prefetch", "Prefetching '" << pathname.string() << "'");
+#endif // HAVE_POSIX_FADVISE
+}
+
+} // namespace ledger
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2003-2009, John Wiegley.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * - Neither the name of New Artisans LLC nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @addtogroup util
+ */
+
+/**
+ * @file   mapped.h
+ * @author John Wiegley
+ *
+ * @ingroup util
+ *
+ * @brief Read-mostly access to a journal file through mmap(2).
+ *
+ * The textual parser walks a journal one line at a time, terminating
+ * lines and fields in place as it goes.  Mapping the file privately
+ * (copy-on-write) lets it do exactly that without first copying each
+ * line out of an istream.
+ */
+#ifndef _MAPPED_H
+#define _MAPPED_H
+
+#include "utils.h"
+
+namespace ledger {
+
+/**
+ * @brief A private, writable mapping of a regular file
+ *
+ * Changes made through the mapping are never written back to the file.
+ * If the file cannot be mapped -- because it is a pipe or device,
+ * because it is empty, or because the platform lacks mmap -- open()
+ * returns false and the caller should fall back to reading it through
+ * an istream.  A file which is to be searched, rather than read from
+ * beginning to end, should be opened as not `sequential'.
+ */
+class mapped_file_t : public noncopyable
+{
+  char *      data;
+  std::size_t size;
+
+public:
+  mapped_file_t() : data(NULL), size(0) {
+    TRACE_CTOR(mapped_file_t, "");
+  }
+  ~mapped_file_t() {
+    TRACE_DTOR(mapped_file_t);
+    close();
+  }
+
+  bool open(const path& pathname, const bool sequential = true);
+  void close();
+
+  bool is_open() const {
+    return data != NULL;
+  }
+
+  char * begin() const {
+    return data;
+  }
+  char * end() const {
+    return data + size;
+  }
+  std::size_t length() const {
+    return size;
+  }
+};
+
+/**
+ * Ask the operating system to begin reading a file into memory, without
+ * waiting for it to finish.  When several journal files are to be parsed
+ * in turn, prefetching them all first lets the reading of the later ones
+ * overlap the parsing of the earlier ones.  This is only a hint, and so
+ * does nothing if the file cannot be opened.
+ */
+void prefetch_file(const path& pathname);
+
+} // namespace ledger
+
+#endif // _MAPPED_H
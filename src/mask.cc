@@ -35,7 +35,22 @@
 
 namespace ledger {
 
-mask_t::mask_t(const string& pat) : expr()
+namespace {
+  inline char fold_case(const char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+  }
+
+  // The literal has already been folded; only the text needs folding
+  bool equal_folded(const char * text, const char * literal, std::size_t len)
+  {
+    for (std::size_t i = 0; i < len; i++)
+      if (fold_case(text[i]) != literal[i])
+	return false;
+    return true;
+  }
+}
+
+mask_t::mask_t(const string& pat) : expr(), kind(REGEX)
 {
   TRACE_CTOR(mask_t, "const string&");
   *this = pat;
@@ -45,7 +60,104 @@ mask_t& mask_t::operator=(const string& pat)
 {
   expr.assign(pat.c_str(), regex::perl | regex::icase);
   VERIFY(valid());
+
+  kind = REGEX;
+  literal.clear();
+
+  if (pat.empty())
+    return *this;
+
+  // Decide whether the pattern is plain text.  Only ASCII patterns are
+  // considered, since the regex engine folds any other case by locale.
+  bool   at_start = false;
+  bool   at_end   = false;
+  string text;
+
+  const char * p = pat.c_str();
+  if (*p == '^') {
+    at_start = true;
+    p++;
+  }
+  for (; *p != '\0'; p++) {
+    if (static_cast<unsigned char>(*p) >= 0x80)
+      return *this;
+
+    if (*p == '\\') {
+      // An escaped metacharacter stands for itself; any other escape,
+      // such as \< or \', may mean something to the regex engine.
+      char next = *(p + 1);
+      if (next == '\0' || ! std::strchr(".[]{}()*+?|^$\\", next))
+	return *this;
+      text += next;
+      p++;
+    }
+    else if (*p == '$' && *(p + 1) == '\0') {
+      at_end = true;
+    }
+    else if (std::strchr(".[]{}()*+?|^$", *p)) {
+      return *this;
+    }
+    else {
+      text += fold_case(*p);
+    }
+  }
+
+  literal = text;
+  if (at_start)
+    kind = at_end ? EXACT : PREFIX;
+  else
+    kind = at_end ? SUFFIX : CONTAINS;
+
   return *this;
 }
 
+bool mask_t::match_literal(const string& str) const
+{
+  const std::size_t len = literal.length();
+
+  switch (kind) {
+  case CONTAINS: {
+    if (len == 0)
+      return true;
+    if (str.length() < len)
+      return false;
+
+    // Look for either case of the first character, then compare the rest
+    const char   first = literal[0];
+    const char   upper = (first >= 'a' && first <= 'z') ?
+      static_cast<char>(first - 'a' + 'A') : first;
+    const char * begin = str.data();
+    const char * last  = begin + (str.length() - len);
+
+    for (const char * q = begin; q <= last; q++)
+      if ((*q == first || *q == upper) &&
+	  equal_folded(q + 1, literal.data() + 1, len - 1))
+	return true;
+    return false;
+  }
+
+  default:
+    // ^ and $ also match at line breaks within the text, which are left
+    // to the regex engine.
+    if (str.find_first_of("\n\r\f") != string::npos)
+      return boost::regex_search(str, expr);
+    break;
+  }
+
+  if (str.length() < len)
+    return false;
+
+  switch (kind) {
+  case PREFIX:
+    return equal_folded(str.data(), literal.data(), len);
+  case SUFFIX:
+    return equal_folded(str.data() + (str.length() - len), literal.data(), len);
+  case EXACT:
+    return str.length() == len && equal_folded(str.data(), literal.data(), len);
+  default:
+    assert(false);
+    return false;
+  }
+}
+
 } // namespace ledger
@@ -58,12 +58,30 @@ class mask_t
 public:
   boost::regex expr;
 
+private:
+  // Most masks are plain text, perhaps anchored at either end.  These
+  // are recognized when the mask is assigned and matched without the
+  // regex engine, against this copy of the text folded to lower case.
+  enum literal_kind_t {
+    REGEX,
+    CONTAINS,
+    PREFIX,
+    SUFFIX,
+    EXACT
+  };
+
+  literal_kind_t kind;
+  string	 literal;
+
+  bool match_literal(const string& str) const;
+
+public:
   explicit mask_t(const string& pattern);
 
-  mask_t() : expr() {
+  mask_t() : expr(), kind(REGEX) {
     TRACE_CTOR(mask_t, "");
   }
-  mask_t(const mask_t& m) : expr(m.expr) {
+  mask_t(const mask_t& m) : expr(m.expr), kind(m.kind), literal(m.literal) {
     TRACE_CTOR(mask_t, "copy");
   }
   ~mask_t() throw() {
@@ -77,10 +95,12 @@ public:
   }
 
   bool match(const string& str) const {
+    bool result = (kind == REGEX ? boost::regex_search(str, expr) :
+		   match_literal(str));
     DEBUG("mask.match",
 	  "Matching: \"" << str << "\" =~ /" << expr.str() << "/ = "
-	  << (boost::regex_search(str, expr) ? "true" : "false"));
-    return boost::regex_search(str, expr);
+	  << (result ? "true" : "false"));
+    return result;
   }
 
   bool empty() const {
@@ -37,12 +37,44 @@
 
 namespace ledger {
 
+namespace {
+  typedef std::map<string, symbol_id_t> symbol_ids_map;
+  typedef std::vector<const string *>	symbol_names_vector;
+
+  symbol_ids_map& symbol_ids() {
+    static symbol_ids_map ids;
+    return ids;
+  }
+  symbol_names_vector& symbol_names() {
+    // Slot zero is left empty, so that no name is ever interned as zero
+    static symbol_names_vector names(1, static_cast<const string *>(NULL));
+    return names;
+  }
+}
+
+symbol_id_t intern_symbol(const string& name)
+{
+  std::pair<symbol_ids_map::iterator, bool> result
+    = symbol_ids().insert(symbol_ids_map::value_type(name, 0));
+  if (result.second) {
+    (*result.first).second = symbol_names().size();
+    symbol_names().push_back(&(*result.first).first);
+  }
+  return (*result.first).second;
+}
+
+const string& symbol_name(const symbol_id_t id)
+{
+  assert(id > 0 && id < symbol_names().size());
+  return *symbol_names()[id];
+}
+
 expr_t::ptr_op_t expr_t::op_t::compile(scope_t& scope)
 {
   if (is_ident()) {
     DEBUG("expr.compile", "Looking up identifier '" << as_ident() << "'");
 
-    if (ptr_op_t def = scope.lookup(as_ident())) {
+    if (ptr_op_t def = scope.resolve(as_symbol())) {
       // Identifier references are first looked up at the point of
       // definition, and then at the point of every use if they could
       // not be found there.
@@ -79,6 +111,32 @@ expr_t::ptr_op_t expr_t::op_t::compile(scope_t& scope)
   }
 
   ptr_op_t lhs(left()->compile(scope));
+
+  // A constant condition settles a short-circuiting operator now, so
+  // that only the branch which can be taken is compiled.
+  if (lhs->is_value()) {
+    switch (kind) {
+    case O_AND:
+      if (lhs->as_value())
+	return right()->compile(scope);
+      return wrap_value(false);
+
+    case O_OR:
+      if (lhs->as_value())
+	return lhs;
+      return right()->compile(scope);
+
+    case O_QUERY:
+      assert(right()->kind == O_COLON);
+      if (lhs->as_value())
+	return right()->left()->compile(scope);
+      return right()->right()->compile(scope);
+
+    default:
+      break;
+    }
+  }
+
   ptr_op_t rhs(kind > UNARY_OPERATORS && has_right() ?
 	       (kind == O_LOOKUP ? right() : right()->compile(scope)) : NULL);
 
@@ -87,8 +145,10 @@ expr_t::ptr_op_t expr_t::op_t::compile(scope_t& scope)
 
   ptr_op_t intermediate(copy(lhs, rhs));
 
-  // Reduce constants immediately if possible
-  if ((! lhs || lhs->is_value()) && (! rhs || rhs->is_value()))
+  // Reduce constants immediately if possible.  The branches of ?: are
+  // never reduced on their own, since O_COLON has no value.
+  if (kind != O_COLON &&
+      (! lhs || lhs->is_value()) && (! rhs || rhs->is_value()))
     return wrap_value(intermediate->calc(scope));
 
   return intermediate;
@@ -167,7 +227,7 @@ value_t expr_t::op_t::calc(scope_t& scope, ptr_op_t * locus)
       if (value_t obj = left()->left()->as_function()(call_args)) {
 	if (obj.is_pointer()) {
 	  scope_t& objscope(obj.as_ref_lval<scope_t>());
-	  if (ptr_op_t member = objscope.lookup(right()->as_ident())) {
+	  if (ptr_op_t member = objscope.resolve(right()->as_symbol())) {
 	    result = member->calc(objscope);
 	    break;
 	  }
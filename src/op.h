@@ -50,6 +50,16 @@
 
 namespace ledger {
 
+/**
+ * Identifier names are interned the first time they are resolved, so
+ * that a scope which has seen a name before can find it again by
+ * number instead of comparing strings.  Zero is never a valid id.
+ */
+typedef std::size_t symbol_id_t;
+
+symbol_id_t   intern_symbol(const string& name);
+const string& symbol_name(const symbol_id_t id);
+
 /**
  * @brief Brief
  *
@@ -67,6 +77,8 @@ private:
   mutable short refc;
   ptr_op_t	left_;
 
+  mutable symbol_id_t symbol;	// interned name of an IDENT
+
   variant<ptr_op_t,		// used by all binary operators
 	  value_t,		// used by constant VALUE
 	  string,		// used by constant IDENT
@@ -127,10 +139,10 @@ public:
 
   kind_t kind;
 
-  explicit op_t() : refc(0), kind(UNKNOWN) {
+  explicit op_t() : refc(0), symbol(0), kind(UNKNOWN) {
     TRACE_CTOR(op_t, "");
   }
-  explicit op_t(const kind_t _kind) : refc(0), kind(_kind) {
+  explicit op_t(const kind_t _kind) : refc(0), symbol(0), kind(_kind) {
     TRACE_CTOR(op_t, "const kind_t");
   }
   ~op_t() {
@@ -166,15 +178,18 @@ public:
     }
     return false;
   }
-  string& as_ident_lval() {
+  const string& as_ident() const {
     assert(is_ident());
     return boost::get<string>(data);
   }
-  const string& as_ident() const {
-    return const_cast<op_t *>(this)->as_ident_lval();
+  symbol_id_t as_symbol() const {
+    if (! symbol)
+      symbol = intern_symbol(as_ident());
+    return symbol;
   }
   void set_ident(const string& val) {
-    data = val;
+    data   = val;
+    symbol = 0;
   }
 
   bool is_function() const {
@@ -256,8 +271,10 @@ private:
 
   ptr_op_t copy(ptr_op_t _left = NULL, ptr_op_t _right = NULL) const {
     ptr_op_t node(new_node(kind, _left, _right));
-    if (kind < TERMINALS)
-      node->data = data;
+    if (kind < TERMINALS) {
+      node->data   = data;
+      node->symbol = symbol;
+    }
     return node;
   }
 
@@ -93,6 +93,7 @@ void format_posts::operator()(post_t& post)
   else if (! post.has_xdata() ||
 	   ! post.xdata().has_flags(POST_EXT_DISPLAYED)) {
     bind_scope_t bound_scope(report, post);
+    item_memo_t	 memo(report, bound_scope);
     if (last_xact != post.xact) {
       if (last_xact) {
 	bind_scope_t xact_scope(report, *last_xact);
@@ -147,6 +148,7 @@ std::size_t format_accounts::post_account(account_t& account)
     account.xdata().add_flags(ACCOUNT_EXT_DISPLAYED);
 
     bind_scope_t bound_scope(report, account);
+    item_memo_t	 memo(report, bound_scope);
     account_line_format.format(report.output_stream, bound_scope);
 
     return 1;
@@ -209,6 +211,7 @@ void format_accounts::flush()
 
   if (! report.HANDLED(no_total) && displayed > 1) {
     bind_scope_t bound_scope(report, *report.session.master);
+    item_memo_t	 memo(report, bound_scope);
     separator_format.format(out, bound_scope);
     total_line_format.format(out, bound_scope);
   }
@@ -40,6 +40,36 @@
 
 namespace ledger {
 
+namespace {
+  struct post_pool_tag {};
+
+  // Ledger is not thread-safe, so the pool need not be locked.
+  typedef boost::singleton_pool<post_pool_tag, sizeof(post_t),
+				boost::default_user_allocator_new_delete,
+				boost::details::pool::null_mutex> post_pool;
+}
+
+void * post_t::operator new(std::size_t size)
+{
+  // A class derived from post_t is bigger than the pool's blocks.
+  if (size != sizeof(post_t))
+    return ::operator new(size);
+
+  if (void * ptr = post_pool::malloc())
+    return ptr;
+  throw std::bad_alloc();
+}
+
+void post_t::operator delete(void * ptr, std::size_t size)
+{
+  if (! ptr)
+    return;
+  if (size != sizeof(post_t))
+    ::operator delete(ptr);
+  else
+    post_pool::free(ptr);
+}
+
 bool post_t::has_tag(const string& tag) const
 {
   if (item_t::has_tag(tag))
@@ -327,6 +357,12 @@ expr_t::ptr_op_t post_t::lookup(const string& name)
   return item_t::lookup(name);
 }
 
+dispatch_table_t * post_t::dispatch_table()
+{
+  static dispatch_table_t table;
+  return &table;
+}
+
 bool post_t::valid() const
 {
   if (! xact) {
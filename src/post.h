@@ -104,6 +104,11 @@ public:
     TRACE_DTOR(post_t);
   }
 
+  // Postings are allocated from a pool of their own, since there are so
+  // many of them, all of the same size.
+  static void * operator new(std::size_t size);
+  static void	operator delete(void * ptr, std::size_t size);
+
   virtual bool has_tag(const string& tag) const;
   virtual bool has_tag(const mask_t& tag_mask,
 		       const optional<mask_t>& value_mask = none) const;
@@ -120,6 +125,7 @@ public:
   }
 
   virtual expr_t::ptr_op_t lookup(const string& name);
+  virtual dispatch_table_t * dispatch_table();
 
   bool valid() const;
 
@@ -32,9 +32,244 @@
 #include <system.hh>
 
 #include "predicate.h"
+#include "op.h"
+#include "scope.h"
+#include "post.h"
+#include "xact.h"
+#include "account.h"
 
 namespace ledger {
 
+namespace {
+  // True if op is the identifier name, bound to what a posting means by it
+  bool is_post_ident(const expr_t::ptr_op_t& op, post_t& post,
+		     const char * name)
+  {
+    return (op->is_ident() && op->as_ident() == name && op->left() &&
+	    op->left() == post.resolve(op->as_symbol()));
+  }
+
+  bool is_mask_value(const expr_t::ptr_op_t& op)
+  {
+    return op->is_value() && op->as_value().is_mask();
+  }
+}
+
+native_predicate_t *
+native_predicate_t::compile(const expr_t::ptr_op_t& op, post_t& post)
+{
+  typedef expr_t::op_t op_t;
+
+  std::auto_ptr<native_predicate_t> pred;
+
+  switch (op->kind) {
+  case op_t::VALUE:
+    if (op->as_value().is_boolean()) {
+      pred.reset(new native_predicate_t(CONSTANT));
+      pred->constant = op->as_value().as_boolean();
+    }
+    break;
+
+  case op_t::IDENT:
+    if (is_post_ident(op, post, "cleared"))
+      pred.reset(new native_predicate_t(CLEARED));
+    else if (is_post_ident(op, post, "pending"))
+      pred.reset(new native_predicate_t(PENDING));
+    else if (is_post_ident(op, post, "uncleared"))
+      pred.reset(new native_predicate_t(UNCLEARED));
+    else if (is_post_ident(op, post, "actual"))
+      pred.reset(new native_predicate_t(ACTUAL));
+    else if (is_post_ident(op, post, "real"))
+      pred.reset(new native_predicate_t(REAL));
+    else if (is_post_ident(op, post, "virtual"))
+      pred.reset(new native_predicate_t(VIRTUAL));
+    break;
+
+  case op_t::O_NOT:
+    if (native_predicate_t * arg = compile(op->left(), post)) {
+      pred.reset(new native_predicate_t(NOT));
+      pred->left.reset(arg);
+    }
+    break;
+
+  case op_t::O_AND:
+  case op_t::O_OR:
+    if (native_predicate_t * lhs = compile(op->left(), post)) {
+      pred.reset(new native_predicate_t(op->kind == op_t::O_AND ? AND : OR));
+      pred->left.reset(lhs);
+      pred->right.reset(compile(op->right(), post));
+      if (! pred->right)
+	pred.reset();
+    }
+    break;
+
+  case op_t::O_MATCH:
+    if (is_mask_value(op->right())) {
+      if (is_post_ident(op->left(), post, "account"))
+	pred.reset(new native_predicate_t(ACCOUNT_MATCH));
+      else if (is_post_ident(op->left(), post, "payee"))
+	pred.reset(new native_predicate_t(PAYEE_MATCH));
+      else if (is_post_ident(op->left(), post, "code"))
+	pred.reset(new native_predicate_t(CODE_MATCH));
+      else if (is_post_ident(op->left(), post, "note"))
+	pred.reset(new native_predicate_t(NOTE_MATCH));
+
+      if (pred.get())
+	pred->mask = op->right()->as_value().as_mask();
+    }
+    break;
+
+  case op_t::O_EQ:
+  case op_t::O_LT:
+  case op_t::O_LTE:
+  case op_t::O_GT:
+  case op_t::O_GTE:
+    if (op->right()->is_value() && op->right()->as_value().is_date() &&
+	is_post_ident(op->left(), post, "date")) {
+      switch (op->kind) {
+      case op_t::O_EQ:	pred.reset(new native_predicate_t(DATE_EQ));  break;
+      case op_t::O_LT:	pred.reset(new native_predicate_t(DATE_LT));  break;
+      case op_t::O_LTE: pred.reset(new native_predicate_t(DATE_LTE)); break;
+      case op_t::O_GT:	pred.reset(new native_predicate_t(DATE_GT));  break;
+      default:		pred.reset(new native_predicate_t(DATE_GTE)); break;
+      }
+      pred->date = op->right()->as_value().as_date();
+    }
+    break;
+
+  case op_t::O_CALL:
+    // The arguments of a call have already been reduced to a single
+    // value by compilation, if they were constants.
+    if (op->has_right() && op->right()->is_value() &&
+	(is_post_ident(op->left(), post, "has_tag") ||
+	 is_post_ident(op->left(), post, "has_meta"))) {
+      const value_t& args(op->right()->as_value());
+      if (args.is_mask()) {
+	pred.reset(new native_predicate_t(HAS_TAG));
+	pred->mask = args.as_mask();
+      }
+      else if (args.is_sequence() && args.size() == 2 &&
+	       args[0].is_mask() && args[1].is_mask()) {
+	pred.reset(new native_predicate_t(HAS_TAG));
+	pred->mask	 = args[0].as_mask();
+	pred->value_mask = args[1].as_mask();
+      }
+    }
+    break;
+
+  default:
+    break;
+  }
+
+  return pred.release();
+}
+
+bool native_predicate_t::operator()(post_t& post) const
+{
+  switch (kind) {
+  case NOT:
+    return ! (*left)(post);
+  case AND:
+    return (*left)(post) && (*right)(post);
+  case OR:
+    return (*left)(post) || (*right)(post);
+  case CONSTANT:
+    return constant;
+
+  case ACCOUNT_MATCH: {
+    const account_t * account = post.reported_account();
+
+    std::size_t slot = account->id * 3;
+    if (post.has_flags(POST_VIRTUAL))
+      slot += post.must_balance() ? 1 : 2;
+
+    if (slot >= accounts_known.size()) {
+      accounts_known.resize(slot + 1, false);
+      accounts_matched.resize(slot + 1, false);
+    }
+
+    if (! accounts_known[slot]) {
+      // This must name the account exactly as the "account" value does
+      bool matched;
+      if (! post.has_flags(POST_VIRTUAL))
+	matched = mask.match(account->fullname());
+      else if (post.must_balance())
+	matched = mask.match(string("[") + account->fullname() + "]");
+      else
+	matched = mask.match(string("(") + account->fullname() + ")");
+
+      accounts_known[slot]   = true;
+      accounts_matched[slot] = matched;
+    }
+    return accounts_matched[slot];
+  }
+  case PAYEE_MATCH:
+    return mask.match(post.xact->payee);
+  case CODE_MATCH:
+    return mask.match(post.xact->code ? *post.xact->code : empty_string);
+  case NOTE_MATCH:
+    return mask.match(post.note ? *post.note : empty_string);
+  case HAS_TAG:
+    return post.has_tag(mask, value_mask);
+
+  case DATE_EQ:
+    return post.date() == date;
+  case DATE_LT:
+    return post.date() <  date;
+  case DATE_LTE:
+    return post.date() <= date;
+  case DATE_GT:
+    return post.date() >  date;
+  case DATE_GTE:
+    return post.date() >= date;
+
+  case CLEARED:
+    return post.state() == item_t::CLEARED;
+  case PENDING:
+    return post.state() == item_t::PENDING;
+  case UNCLEARED:
+    return post.state() == item_t::UNCLEARED;
+  case ACTUAL:
+    return ! post.has_flags(ITEM_GENERATED);
+  case REAL:
+    return ! post.has_flags(POST_VIRTUAL);
+  case VIRTUAL:
+    return post.has_flags(POST_VIRTUAL);
+  }
+  assert(false);
+  return false;
+}
+
+bool item_predicate::operator()(scope_t& item)
+{
+  try {
+    if (! predicate)
+      return true;
+
+    predicate.compile(item);
+
+    if (post_t * post = search_scope<post_t>(&item)) {
+      expr_t::ptr_op_t op(predicate.get_op());
+      if (op != native_op) {
+	native_op = op;
+	native.reset(native_predicate_t::compile(op, *post));
+	DEBUG("predicate.native",
+	      (native ? "Compiled predicate natively: " :
+	       "Predicate left to the expression evaluator: ") << predicate);
+      }
+      if (native)
+	return (*native)(*post);
+    }
+
+    return predicate.calc(item).strip_annotations(what_to_keep);
+  }
+  catch (const std::exception& err) {
+    add_error_context(_("While determining truth of predicate expression:"));
+    add_error_context(expr_context(predicate));
+    throw;
+  }
+}
+
 string args_to_predicate_expr(value_t::sequence_t::const_iterator& begin,
 			      value_t::sequence_t::const_iterator end)
 {
@@ -51,6 +51,73 @@
 
 namespace ledger {
 
+class post_t;
+
+/**
+ * @brief A predicate reduced to direct tests on a posting
+ *
+ * Predicates made only of account, payee, code and note matches, tag
+ * tests, date comparisons and the item state, joined by &, | and !, are
+ * turned into a tree of these the first time they are applied to a
+ * posting, so that they can be answered without evaluating the
+ * expression at all.
+ */
+class native_predicate_t : public noncopyable
+{
+public:
+  enum kind_t {
+    NOT,
+    AND,
+    OR,
+    CONSTANT,
+    ACCOUNT_MATCH,
+    PAYEE_MATCH,
+    CODE_MATCH,
+    NOTE_MATCH,
+    HAS_TAG,
+    DATE_EQ,
+    DATE_LT,
+    DATE_LTE,
+    DATE_GT,
+    DATE_GTE,
+    CLEARED,
+    PENDING,
+    UNCLEARED,
+    ACTUAL,
+    REAL,
+    VIRTUAL
+  };
+
+  kind_t			 kind;
+  bool				 constant;
+  mask_t			 mask;
+  optional<mask_t>		 value_mask;
+  date_t			 date;
+  scoped_ptr<native_predicate_t> left;
+  scoped_ptr<native_predicate_t> right;
+
+  // An account's name never changes, so ACCOUNT_MATCH remembers what the
+  // mask said about each one.  Both are indexed by the account's id
+  // times three, plus one for a [balanced] or two for a (virtual) post.
+  mutable std::vector<bool>	 accounts_known;
+  mutable std::vector<bool>	 accounts_matched;
+
+  explicit native_predicate_t(const kind_t _kind)
+    : kind(_kind), constant(false) {
+    TRACE_CTOR(native_predicate_t, "const kind_t");
+  }
+  ~native_predicate_t() throw() {
+    TRACE_DTOR(native_predicate_t);
+  }
+
+  bool operator()(post_t& post) const;
+
+  // Returns NULL if op contains anything which cannot be tested directly,
+  // or uses identifiers that were not bound to those of a posting.
+  static native_predicate_t * compile(const expr_t::ptr_op_t& op,
+				      post_t& post);
+};
+
 /**
  * @brief Brief
  *
@@ -62,6 +129,9 @@ public:
   expr_t	 predicate;
   keep_details_t what_to_keep;
 
+  expr_t::ptr_op_t		 native_op; // the op native was built from
+  shared_ptr<native_predicate_t> native;
+
   item_predicate() {
     TRACE_CTOR(item_predicate, "");
   }
@@ -83,16 +153,7 @@ public:
     TRACE_DTOR(item_predicate);
   }
 
-  bool operator()(scope_t& item) {
-    try {
-      return ! predicate || predicate.calc(item).strip_annotations(what_to_keep);
-    }
-    catch (const std::exception& err) {
-      add_error_context(_("While determining truth of predicate expression:"));
-      add_error_context(expr_context(predicate));
-      throw;
-    }
-  }
+  bool operator()(scope_t& item);
 };
 
 string args_to_predicate_expr(value_t::sequence_t::const_iterator& begin,
@@ -0,0 +1,669 @@
+/*
+ * Copyright (c) 2003-2009, John Wiegley.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * - Neither the name of New Artisans LLC nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <system.hh>
+
+#include "pricedb.h"
+
+namespace ledger {
+
+namespace {
+  const uint_least32_t PRICEDB_MAGIC   = 0x4c444750; // "LDGP"
+  const uint_least32_t PRICEDB_VERSION = 0x00030002;
+
+  // The header holds the magic number and version, followed by the
+  // number of series, of records, of bytes of symbol and price text, and
+  // of commodities given no market value.  These last are the offsets of
+  // their symbols, and come between the records and the text.  Prices
+  // appended later follow the text, each written out in full.
+
+  // A series is the offsets of its commodity's symbol and of the symbol
+  // of the commodity it is priced in, followed by its first record and
+  // its number of records.
+  const std::size_t SERIES_SIZE = 4 * sizeof(uint_least32_t);
+
+  // A record is a moment, in ticks since 1970, followed by the offset of
+  // the text of its price.
+  const std::size_t RECORD_SIZE = sizeof(int64_t) + sizeof(uint_least32_t);
+
+  const datetime_t EPOCH(date_t(1970, 1, 1));
+
+  template <typename T>
+  void write_binary(std::ostream& out, const T& value)
+  {
+    out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+  }
+
+  void write_string(std::ostream& out, const string& str)
+  {
+    write_binary(out, static_cast<uint_least32_t>(str.length()));
+    out.write(str.data(), static_cast<std::streamsize>(str.length()));
+  }
+
+  template <typename T>
+  T peek_binary(const char * data)
+  {
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+  }
+
+  class price_store_reader_t
+  {
+    const char * data;
+    const char * end;
+
+  public:
+    price_store_reader_t(const char * _data, const char * _end)
+      : data(_data), end(_end) {}
+
+    bool at_end() const {
+      return data == end;
+    }
+
+    void check_length(std::size_t length) {
+      if (static_cast<std::size_t>(end - data) < length)
+	throw_(price_store_error, _("Unexpected end of price store"));
+    }
+
+    const char * skip(std::size_t length) {
+      check_length(length);
+      const char * start = data;
+      data += length;
+      return start;
+    }
+
+    template <typename T>
+    T read_binary() {
+      return peek_binary<T>(skip(sizeof(T)));
+    }
+
+    string read_string() {
+      uint_least32_t len = read_binary<uint_least32_t>();
+      return string(skip(len), len);
+    }
+  };
+
+  /**
+   * Where the parts of a store lie, once its header has been read.
+   */
+  struct layout_t
+  {
+    uint_least32_t series_count;
+    uint_least32_t record_count;
+    uint_least32_t strings_size;
+    uint_least32_t nomarket_count;
+
+    const char * series;
+    const char * records;
+    const char * nomarket;
+    const char * strings;
+
+    void read(price_store_reader_t& reader) {
+      if (reader.read_binary<uint_least32_t>() != PRICEDB_MAGIC ||
+	  reader.read_binary<uint_least32_t>() != PRICEDB_VERSION)
+	throw_(price_store_error,
+	       _("Not a price store written by this version of Ledger"));
+
+      series_count = reader.read_binary<uint_least32_t>();
+      record_count = reader.read_binary<uint_least32_t>();
+      strings_size   = reader.read_binary<uint_least32_t>();
+      nomarket_count = reader.read_binary<uint_least32_t>();
+
+      series   = reader.skip(series_count * SERIES_SIZE);
+      records  = reader.skip(record_count * RECORD_SIZE);
+      nomarket = reader.skip(nomarket_count * sizeof(uint_least32_t));
+      strings  = reader.skip(strings_size);
+    }
+
+    const char * read_nomarket(uint_least32_t index) const {
+      uint_least32_t offset =
+	peek_binary<uint_least32_t>(nomarket + index * sizeof(uint_least32_t));
+      if (offset >= strings_size)
+	throw_(price_store_error, _("Invalid commodity in price store"));
+      return strings + offset;
+    }
+
+    void read_series(uint_least32_t	index,
+		     const char *&	symbol,
+		     const char *&	price_symbol,
+		     uint_least32_t&	first,
+		     uint_least32_t&	count) const {
+      const char *   p		   = series + index * SERIES_SIZE;
+      uint_least32_t symbol_offset = peek_binary<uint_least32_t>(p);
+      uint_least32_t price_offset  = peek_binary<uint_least32_t>(p + 4);
+      first = peek_binary<uint_least32_t>(p + 8);
+      count = peek_binary<uint_least32_t>(p + 12);
+
+      if (symbol_offset >= strings_size || price_offset >= strings_size ||
+	  first > record_count || count > record_count - first)
+	throw_(price_store_error, _("Invalid series in price store"));
+
+      symbol	   = strings + symbol_offset;
+      price_symbol = strings + price_offset;
+    }
+  };
+
+  struct entry_less
+  {
+    bool operator()(const price_store_t::entry_t& left,
+		    const price_store_t::entry_t& right) const {
+      if (left.symbol != right.symbol)
+	return left.symbol < right.symbol;
+      if (left.price_symbol != right.price_symbol)
+	return left.price_symbol < right.price_symbol;
+      return left.when < right.when;
+    }
+  };
+
+  /**
+   * Sort prices into their series, and where the same price was given
+   * more than once keep only the last given.
+   */
+  void sort_entries(std::vector<price_store_t::entry_t>& entries)
+  {
+    std::stable_sort(entries.begin(), entries.end(), entry_less());
+
+    std::vector<price_store_t::entry_t>::iterator last = entries.begin();
+    foreach (const price_store_t::entry_t& entry, entries) {
+      if (last != entries.begin() && (last - 1)->when == entry.when &&
+	  (last - 1)->symbol == entry.symbol &&
+	  (last - 1)->price_symbol == entry.price_symbol)
+	*(last - 1) = entry;
+      else
+	*last++ = entry;
+    }
+    entries.erase(last, entries.end());
+  }
+
+  uint_least32_t append_text(string& strings, const string& str)
+  {
+    uint_least32_t offset = static_cast<uint_least32_t>(strings.length());
+    strings.append(str);
+    strings.push_back('\0');
+    return offset;
+  }
+
+  int64_t to_ticks(const datetime_t& when)
+  {
+    return (when - EPOCH).ticks();
+  }
+
+  datetime_t from_ticks(const int64_t ticks)
+  {
+    return EPOCH + time_duration_t(0, 0, 0, ticks);
+  }
+
+  /**
+   * Commodities created while importing a price database belong to a
+   * pool of their own, so that only what is read back from the store
+   * ever reaches the one a report uses.
+   */
+  class scratch_pool_t
+  {
+    shared_ptr<commodity_pool_t> saved;
+
+  public:
+    scratch_pool_t() : saved(amount_t::current_pool) {
+      amount_t::current_pool.reset(new commodity_pool_t);
+    }
+    ~scratch_pool_t() {
+      amount_t::current_pool = saved;
+    }
+  };
+}
+
+datetime_t price_series_t::when(std::size_t index) const
+{
+  return from_ticks(peek_binary<int64_t>(records + index * RECORD_SIZE));
+}
+
+const char * price_series_t::text(std::size_t index) const
+{
+  return strings + peek_binary<uint_least32_t>(records + index * RECORD_SIZE +
+					       sizeof(int64_t));
+}
+
+amount_t price_series_t::price(std::size_t index) const
+{
+  // The prices were read as text once already, when they were imported;
+  // reading them again here, whenever a valuation happens to need them,
+  // must not change how their commodities are displayed.
+  amount_t amt;
+  amt.parse(text(index), amount_t::PARSE_NO_MIGRATE);
+  if (inverse) {
+    amount_t inverted = amt.inverted();
+    inverted.set_commodity(*inverse);
+    return inverted;
+  }
+  return amt;
+}
+
+std::size_t price_series_t::upper_bound(const datetime_t& moment) const
+{
+  // Most moments asked about lie after the last record or before the
+  // first, and need no search at all.
+  if (count == 0 || when(0) > moment)
+    return 0;
+  if (when(count - 1) <= moment)
+    return count;
+
+  std::size_t low = 1, high = count - 1;
+  while (low < high) {
+    std::size_t mid = low + (high - low) / 2;
+    if (when(mid) <= moment)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+  return low;
+}
+
+optional<price_point_t>
+price_series_t::find_price(const optional<datetime_t>& moment) const
+{
+  // Find the last record on or before the moment.
+  std::size_t index = moment ? upper_bound(*moment) : count;
+  if (index == 0)
+    return none;
+
+  price_point_t point;
+  point.when  = when(index - 1);
+  point.price = price(index - 1);
+  return point;
+}
+
+optional<datetime_t> price_series_t::latest(const datetime_t& moment) const
+{
+  std::size_t index = upper_bound(moment);
+  if (index == 0)
+    return none;
+  return when(index - 1);
+}
+
+void price_store_t::load(commodity_pool_t& pool)
+{
+  if (! exists(file))
+    return;
+
+  if (! mapped.open(file, false)) {
+    ifstream in(file, std::ios::binary);
+    buffer.assign(std::istreambuf_iterator<char>(in),
+		  std::istreambuf_iterator<char>());
+  }
+
+  price_store_reader_t
+    reader(mapped.is_open() ? mapped.begin() : buffer.data(),
+	   mapped.is_open() ? mapped.end() : buffer.data() + buffer.length());
+
+  INFO_START(pricedb, "Read price store");
+
+  try {
+    layout_t layout;
+    layout.read(reader);
+
+    for (uint_least32_t i = 0; i < layout.series_count; i++) {
+      const char *   symbol;
+      const char *   price_symbol;
+      uint_least32_t first;
+      uint_least32_t count;
+      layout.read_series(i, symbol, price_symbol, first, count);
+
+      commodity_t * comm       = pool.find_or_create(symbol);
+      commodity_t * price_comm = pool.find_or_create(price_symbol);
+      if (! comm || ! price_comm || comm == price_comm)
+	continue;
+
+      comm->add_flags(COMMODITY_KNOWN);
+      price_comm->add_flags(COMMODITY_PRIMARY);
+
+      // The commodity's history in the other refers to the prices as
+      // stored, and the other's history in it to them inverted, just as
+      // reading them as P lines would have recorded them.
+      price_series_t direct;
+      direct.records = layout.records + first * RECORD_SIZE;
+      direct.count   = count;
+      direct.strings = layout.strings;
+      direct.inverse = NULL;
+      series.push_back(direct);
+
+      if (! comm->base->varied_history)
+	comm->base->varied_history = commodity_t::varied_history_t();
+      comm->base->varied_history->histories[price_comm].stored
+	.push_back(&series.back());
+
+      price_series_t inverted(direct);
+      inverted.inverse = comm;
+      series.push_back(inverted);
+
+      if (! price_comm->base->varied_history)
+	price_comm->base->varied_history = commodity_t::varied_history_t();
+      price_comm->base->varied_history->histories[comm].stored
+	.push_back(&series.back());
+    }
+
+    for (uint_least32_t i = 0; i < layout.nomarket_count; i++)
+      if (commodity_t * comm = pool.find_or_create(layout.read_nomarket(i)))
+	comm->add_flags(COMMODITY_NOMARKET | COMMODITY_KNOWN);
+
+    // Whatever was appended since the store was last written is added to
+    // the histories like any other price, and is read as the stored
+    // prices are, without changing how its commodity is displayed.
+    while (! reader.at_end()) {
+      int64_t ticks = reader.read_binary<int64_t>();
+      string  symbol(reader.read_string());
+      reader.read_string();	// the symbol of the price's commodity
+      amount_t price;
+      price.parse(reader.read_string(), amount_t::PARSE_NO_MIGRATE);
+
+      if (commodity_t * comm = pool.find_or_create(symbol)) {
+	comm->add_price(from_ticks(ticks), price, true);
+	comm->add_flags(COMMODITY_KNOWN);
+      }
+    }
+  }
+  catch (const std::exception& err) {
+    add_error_context(_("While reading price store %1:") << file);
+    throw;
+  }
+
+  // The series were attached without add_price(), so anything the pool
+  // has computed from the histories is now out of date.
+  pool.price_epoch++;
+  pool.price_cache.clear();
+  pool.price_tables.clear();
+
+  INFO_FINISH(pricedb);
+
+  DEBUG("pricedb.load", "Attached " << series.size()
+	<< " price series from " << file);
+}
+
+void price_store_t::read_entries(std::vector<entry_t>& entries,
+				 std::set<string>&     nomarket) const
+{
+  if (! exists(file))
+    return;
+
+  string contents;
+  {
+    ifstream in(file, std::ios::binary);
+    contents.assign(std::istreambuf_iterator<char>(in),
+		    std::istreambuf_iterator<char>());
+  }
+
+  price_store_reader_t reader(contents.data(),
+			      contents.data() + contents.length());
+  try {
+    layout_t layout;
+    layout.read(reader);
+
+    for (uint_least32_t i = 0; i < layout.series_count; i++) {
+      const char *   symbol;
+      const char *   price_symbol;
+      uint_least32_t first;
+      uint_least32_t count;
+      layout.read_series(i, symbol, price_symbol, first, count);
+
+      price_series_t stored;
+      stored.records = layout.records + first * RECORD_SIZE;
+      stored.count   = count;
+      stored.strings = layout.strings;
+      stored.inverse = NULL;
+
+      for (uint_least32_t j = 0; j < count; j++) {
+	entry_t entry;
+	entry.symbol	   = symbol;
+	entry.price_symbol = price_symbol;
+	entry.when	   = to_ticks(stored.when(j));
+	entry.price	   = stored.text(j);
+	entries.push_back(entry);
+      }
+    }
+
+    for (uint_least32_t i = 0; i < layout.nomarket_count; i++)
+      nomarket.insert(layout.read_nomarket(i));
+
+    while (! reader.at_end()) {
+      entry_t entry;
+      entry.when	 = reader.read_binary<int64_t>();
+      entry.symbol	 = reader.read_string();
+      entry.price_symbol = reader.read_string();
+      entry.price	 = reader.read_string();
+      entries.push_back(entry);
+    }
+  }
+  catch (const std::exception& err) {
+    add_error_context(_("While reading price store %1:") << file);
+    throw;
+  }
+}
+
+void price_store_t::write_entries(std::vector<entry_t>&  entries,
+				  const std::set<string>& nomarket) const
+{
+  sort_entries(entries);
+
+  // Symbols are stored once each; the text of each price is stored once
+  // for every record, since few are ever the same.
+  string			   strings;
+  std::map<string, uint_least32_t> symbols;
+
+  std::ostringstream nomarket_out;
+  foreach (const string& symbol, nomarket) {
+    uint_least32_t offset = append_text(strings, symbol);
+    symbols.insert(std::pair<string, uint_least32_t>(symbol, offset));
+    write_binary(nomarket_out, offset);
+  }
+
+  std::ostringstream series_out;
+  std::ostringstream records_out;
+  uint_least32_t     series_count = 0;
+
+  for (std::size_t i = 0; i < entries.size(); ) {
+    std::size_t j = i + 1;
+    while (j < entries.size() && entries[j].symbol == entries[i].symbol &&
+	   entries[j].price_symbol == entries[i].price_symbol)
+      j++;
+
+    const string * names[2] = { &entries[i].symbol, &entries[i].price_symbol };
+    for (int k = 0; k < 2; k++) {
+      std::map<string, uint_least32_t>::iterator s = symbols.find(*names[k]);
+      if (s == symbols.end())
+	s = symbols.insert(std::pair<string, uint_least32_t>
+			   (*names[k], append_text(strings, *names[k]))).first;
+      write_binary(series_out, (*s).second);
+    }
+    write_binary(series_out, static_cast<uint_least32_t>(i));
+    write_binary(series_out, static_cast<uint_least32_t>(j - i));
+    series_count++;
+
+    for (; i < j; i++) {
+      write_binary(records_out, entries[i].when);
+      write_binary(records_out, append_text(strings, entries[i].price));
+    }
+  }
+
+  // The store is written beside its final name and then moved into
+  // place, so that a reader never sees one that is only partly written.
+  path temp(file.string() + ".tmp");
+  {
+    ofstream out(temp, std::ios::binary | std::ios::trunc);
+    if (! out)
+      throw_(price_store_error, _("Cannot write price store %1") << temp);
+
+    write_binary(out, PRICEDB_MAGIC);
+    write_binary(out, PRICEDB_VERSION);
+    write_binary(out, series_count);
+    write_binary(out, static_cast<uint_least32_t>(entries.size()));
+    write_binary(out, static_cast<uint_least32_t>(strings.length()));
+    write_binary(out, static_cast<uint_least32_t>(nomarket.size()));
+    out << series_out.str() << records_out.str() << nomarket_out.str()
+	<< strings;
+
+    if (! out.good()) {
+      out.close();
+      boost::filesystem::remove(temp);
+      throw_(price_store_error, _("Failed writing price store %1") << temp);
+    }
+  }
+
+  if (std::rename(temp.string().c_str(), file.string().c_str()) != 0) {
+    boost::filesystem::remove(temp);
+    throw_(price_store_error,
+	   _("Cannot move price store into place at %1") << file);
+  }
+
+  DEBUG("pricedb.save", "Wrote " << entries.size() << " prices in "
+	<< series_count << " series to " << file);
+}
+
+void price_store_t::import(const path& pathname)
+{
+  INFO_START(pricedb, "Imported price database into price store");
+
+  std::vector<entry_t> entries;
+  std::set<string>     nomarket;
+  read_entries(entries, nomarket);
+
+  ifstream in(pathname);
+  if (! in)
+    throw_(price_store_error, _("Cannot read price database %1") << pathname);
+
+  std::size_t linenum = 0;
+  string      line;
+  try {
+    scratch_pool_t scratch;
+
+    while (std::getline(in, line)) {
+      linenum++;
+      if (! line.empty() && line[line.length() - 1] == '\r')
+	line.erase(line.length() - 1);
+
+      if (line.empty() || (line[0] != 'P' && line[0] != 'N')) {
+	if (! line.empty() && std::isdigit(line[0]))
+	  throw_(price_store_error,
+		 _("Transactions not allowed in price history file"));
+	continue;
+      }
+
+      std::vector<char> buf(line.begin(), line.end());
+      buf.push_back('\0');
+
+      if (line[0] == 'N') {
+	char * p = skip_ws(&buf[0] + 1);
+	string symbol;
+	commodity_t::parse_symbol(p, symbol);
+	nomarket.insert(symbol);
+	continue;
+      }
+
+      datetime_t   datetime;
+      amount_t	   price;
+      commodity_t * comm =
+	amount_t::current_pool->parse_price_directive(&buf[0] + 1,
+						      datetime, price);
+      if (! comm)
+	continue;
+
+      entry_t entry;
+      entry.symbol	 = comm->base_symbol();
+      entry.price_symbol = price.commodity().base_symbol();
+      entry.when	 = to_ticks(datetime);
+      entry.price	 = price.to_fullstring();
+      entries.push_back(entry);
+    }
+  }
+  catch (const std::exception& err) {
+    add_error_context(_("While importing line %1 of %2:")
+		      << linenum << pathname);
+    throw;
+  }
+
+  write_entries(entries, nomarket);
+
+  INFO_FINISH(pricedb);
+}
+
+void price_store_t::append(const commodity_t&  comm,
+			   const datetime_t& when,
+			   const amount_t&   price)
+{
+  // A store not yet written must begin with an empty header, which is
+  // what writing no prices at all produces.
+  if (! exists(file)) {
+    std::vector<entry_t> none;
+    write_entries(none, std::set<string>());
+  }
+
+  ofstream out(file, std::ios::binary | std::ios::app);
+  if (! out)
+    throw_(price_store_error, _("Cannot append to price store %1") << file);
+
+  write_binary(out, to_ticks(when));
+  write_string(out, comm.base_symbol());
+  write_string(out, price.commodity().base_symbol());
+  write_string(out, price.to_fullstring());
+}
+
+void price_store_t::print(std::ostream& out) const
+{
+  std::vector<entry_t> entries;
+  std::set<string>     nomarket;
+  read_entries(entries, nomarket);
+  sort_entries(entries);
+
+  foreach (const string& symbol, nomarket) {
+    out << "N ";
+    if (commodity_t::symbol_needs_quotes(symbol))
+      out << '"' << symbol << '"';
+    else
+      out << symbol;
+    out << '\n';
+  }
+
+  foreach (const entry_t& entry, entries) {
+    datetime_t	    when(from_ticks(entry.when));
+    time_duration_t time(when.time_of_day());
+
+    out << "P " << format_date(when.date(), string("%Y/%m/%d")) << ' '
+	<< std::setfill('0') << std::setw(2) << time.hours() << ':'
+	<< std::setw(2) << time.minutes() << ':'
+	<< std::setw(2) << time.seconds() << std::setfill(' ') << ' ';
+    if (commodity_t::symbol_needs_quotes(entry.symbol))
+      out << '"' << entry.symbol << '"';
+    else
+      out << entry.symbol;
+    out << ' ' << entry.price << '\n';
+  }
+}
+
+} // namespace ledger
@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2003-2009, John Wiegley.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ *
+ * - Neither the name of New Artisans LLC nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * @addtogroup math
+ */
+
+/**
+ * @file   pricedb.h
+ * @author John Wiegley
+ *
+ * @ingroup math
+ *
+ * @brief A binary store of commodity prices.
+ *
+ * A price database given with --price-db is text, one P line for each
+ * price, and all of it must be parsed on every run even though a report
+ * may only ever value a few commodities.  A price store (--price-store)
+ * keeps the same prices in binary, sorted by commodity and date, so that
+ * the file can be mapped into memory as it is.  Each price history then
+ * refers to its part of the store, which is only searched, and its
+ * prices only parsed, when a valuation asks for them.
+ */
+#ifndef _PRICEDB_H
+#define _PRICEDB_H
+
+#include "amount.h"
+#include "commodity.h"
+#include "mapped.h"
+
+namespace ledger {
+
+DECLARE_EXCEPTION(price_store_error, std::runtime_error);
+
+/**
+ * @brief The prices of one commodity in terms of another, as stored
+ *
+ * The records are those of a single commodity in a single other, in
+ * date order, and are read straight out of the mapped store.  Each
+ * price history refers to the series it would have had its prices from
+ * had they been read as text: a series is kept for the commodity priced,
+ * and an inverted one for the commodity it is priced in.
+ */
+struct price_series_t
+{
+  const char *	records;
+  std::size_t	count;
+  const char *	strings;
+  commodity_t * inverse;	// if set, prices are inverted into this
+
+  datetime_t   when(std::size_t index) const;
+  const char * text(std::size_t index) const;
+  amount_t     price(std::size_t index) const;
+
+  optional<price_point_t> find_price(const optional<datetime_t>& moment) const;
+
+  /**
+   * The date of the last record on or before `moment', found without
+   * reading any record outside the bisection.
+   */
+  optional<datetime_t> latest(const datetime_t& moment) const;
+
+private:
+  std::size_t upper_bound(const datetime_t& moment) const;
+};
+
+/**
+ * @brief A price store file
+ *
+ * The store is written whole, by import(), sorted so that each series
+ * is contiguous.  Prices fetched afterward are appended to the end of
+ * it, unsorted, and are added to the price histories as they are read;
+ * the next import() sorts them into place.
+ */
+class price_store_t : public noncopyable
+{
+  path			    file;
+  mapped_file_t		    mapped;
+  string		    buffer;
+  std::list<price_series_t> series;
+
+public:
+  struct entry_t
+  {
+    string  symbol;
+    string  price_symbol;
+    int64_t when;
+    string  price;
+  };
+
+  explicit price_store_t(const path& _file) : file(_file) {
+    TRACE_CTOR(price_store_t, "const path&");
+  }
+  ~price_store_t() {
+    TRACE_DTOR(price_store_t);
+  }
+
+  /**
+   * Map the store and attach its series to the price histories of
+   * `pool'.  A store which does not exist yet holds no prices.
+   */
+  void load(commodity_pool_t& pool);
+
+  /**
+   * Rewrite the store with every price it holds, together with those of
+   * the P lines in the text price database `pathname', and the
+   * commodities its N lines give no market value.  A price given in both
+   * for the same moment is taken from the text.  Reading the text
+   * creates no commodities in the current pool.
+   */
+  void import(const path& pathname);
+
+  /**
+   * Add a price to the end of the store, without rewriting it.
+   */
+  void append(const commodity_t&  comm,
+	      const datetime_t& when,
+	      const amount_t&	price);
+
+  /**
+   * Print every price in the store as a P line, and every commodity
+   * without a market value as an N line, such as import() reads.
+   */
+  void print(std::ostream& out) const;
+
+private:
+  void read_entries(std::vector<entry_t>& entries,
+		    std::set<string>&	  nomarket) const;
+  void write_entries(std::vector<entry_t>&  entries,
+		     const std::set<string>& nomarket) const;
+};
+
+} // namespace ledger
+
+#endif // _PRICEDB_H
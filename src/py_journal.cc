@@ -260,6 +260,14 @@ value_t py_post_amount(post_t * post) {
   return value_t(post->amount);
 }
 
+string py_xact_payee(xact_t& xact) {
+  return xact.payee;
+}
+
+void py_set_xact_payee(xact_t& xact, const string& payee) {
+  xact.payee = payee;
+}
+
 post_t::state_t py_xact_state(xact_t * xact) {
   post_t::state_t state;
   if (xact->get_state(&state))
@@ -419,7 +427,7 @@ void export_journal()
     .add_property("actual_date", &xact_t::actual_date)
 
     .def_readwrite("code", &xact_t::code)
-    .def_readwrite("payee", &xact_t::payee)
+    .add_property("payee", &py_xact_payee, &py_set_xact_payee)
 
     .add_property("state", &py_xact_state)
 
@@ -32,78 +32,202 @@
 #include <system.hh>
 
 #include "quotes.h"
+#include "pricedb.h"
+#include "journal.h"
+#include "xact.h"
+#include "post.h"
 
 namespace ledger {
 
-#if 0
-void quotes_by_script::operator()(commodity_base_t& commodity,
-				  const datetime_t& moment,
-				  const datetime_t& date,
-				  const datetime_t& last,
-				  amount_t&	    price)
+namespace {
+  struct symbol_less
+  {
+    bool operator()(const commodity_t * left,
+		    const commodity_t * right) const {
+      return left->symbol() < right->symbol();
+    }
+  };
+
+  struct running_quote_t
+  {
+    commodity_t * commodity;
+    FILE *	  pipe;
+  };
+
+  // Closes the pipes of any scripts still running when a download is
+  // abandoned, so that none of them is left behind.
+  struct running_quotes_closer
+  {
+    std::deque<running_quote_t>& running;
+
+    running_quotes_closer(std::deque<running_quote_t>& _running)
+      : running(_running) {}
+    ~running_quotes_closer() {
+      foreach (running_quote_t& quote, running)
+	pclose(quote.pipe);
+    }
+  };
+
+  // The script is run by the shell, so the symbol is passed as a single
+  // quoted word with nothing in it the shell would interpret.
+  string shell_quoted(const string& str)
+  {
+    string quoted("'");
+    foreach (char c, str) {
+      if (c == '\'')
+	quoted += "'\\''";
+      else
+	quoted += c;
+    }
+    quoted += "'";
+    return quoted;
+  }
+}
+
+std::vector<commodity_t *>
+quotes_by_script::needing_quotes(journal_t& journal,
+				 const datetime_t& now) const
 {
-  DEBUG_CLASS("ledger.quotes.download");
-
-  DEBUG_("commodity: " << commodity.symbol);
-  DEBUG_TIME_(current_moment);
-  DEBUG_TIME_(moment);
-  DEBUG_TIME_(date);
-  DEBUG_TIME_(last);
-  if (commodity.history)
-    DEBUG_TIME_(commodity.history->last_lookup);
-  DEBUG_("pricing_leeway is " << pricing_leeway);
-
-  if ((commodity.history &&
-       (current_moment - commodity.history->last_lookup) < pricing_leeway) ||
-      (current_moment - last) < pricing_leeway ||
-      (price && moment > date && (moment - date) <= pricing_leeway))
-    return;
+  std::set<commodity_t *, symbol_less> held;
+  foreach (xact_t * xact, journal.xacts)
+    foreach (post_t * post, xact->posts)
+      if (post->amount.has_commodity())
+	held.insert(&post->amount.commodity().referent());
+
+  time_duration_t within(0, 0, leeway);
+
+  std::vector<commodity_t *> needed;
+  foreach (commodity_t * comm, held) {
+    if (comm->has_flags(COMMODITY_NOMARKET | COMMODITY_BUILTIN |
+			COMMODITY_PRIMARY))
+      continue;
+
+    bool recent = false;
+    if (optional<commodity_t::varied_history_t&> hist =
+	comm->varied_history()) {
+      foreach (const commodity_t::history_by_commodity_map::value_type&
+	       pair, hist->histories) {
+	const commodity_t::history_t& history(pair.second);
+	if (! history.last_lookup.is_not_a_date_time() &&
+	    now - history.last_lookup < within)
+	  recent = true;
+	else if (optional<price_point_t> point = history.find_price())
+	  if (now - point->when < within)
+	    recent = true;
+	if (recent)
+	  break;
+      }
+    }
+
+    DEBUG("quotes.download", "Commodity " << comm->symbol()
+	  << (recent ? " has a recent price" : " needs a quote"));
+    if (! recent)
+      needed.push_back(comm);
+  }
+  return needed;
+}
 
-  using namespace std;
+void quotes_by_script::download(const std::vector<commodity_t *>& commodities,
+				const datetime_t& now)
+{
+  if (commodities.empty())
+    return;
 
-  DEBUG_("downloading quote for symbol " << commodity.symbol);
+  INFO_START(quotes, "Downloaded " << commodities.size() << " quotes");
+
+  // Each script is started as soon as there is room for it, and its
+  // output is read only once the scripts started before it have been
+  // read, so that up to `jobs' of them are waiting on the network at
+  // once.
+  std::deque<running_quote_t> running;
+  running_quotes_closer	      closer(running);
+  std::vector<commodity_t *>  failed;
+  std::size_t		      next = 0;
+
+  while (next < commodities.size() || ! running.empty()) {
+    if (next < commodities.size() && running.size() < jobs) {
+      running_quote_t quote;
+      quote.commodity = commodities[next++];
+
+      string cmd(command + " " +
+		 shell_quoted(quote.commodity->base_symbol()));
+      DEBUG("quotes.download", "Running: " << cmd);
+
+      quote.pipe = popen(cmd.c_str(), "r");
+      if (quote.pipe)
+	running.push_back(quote);
+      else
+	failed.push_back(quote.commodity);
+      continue;
+    }
 
-  char buf[256];
-  buf[0] = '\0';
+    running_quote_t quote = running.front();
+    running.pop_front();
 
-  bool success = true;
+    char buf[256];
+    buf[0] = '\0';
 
-  if (FILE * fp = popen((string("getquote \"") +
-			 commodity.symbol + "\"").c_str(), "r")) {
-    if (feof(fp) || ! fgets(buf, 255, fp))
+    bool success = true;
+    if (std::feof(quote.pipe) || ! std::fgets(buf, 255, quote.pipe))
       success = false;
-    if (pclose(fp) != 0)
+    if (pclose(quote.pipe) != 0)
       success = false;
-  } else {
-    success = false;
+
+    if (char * p = std::strchr(buf, '\n'))
+      *p = '\0';
+
+    if (success && buf[0]) {
+      DEBUG("quotes.download", "Downloaded quote for "
+	    << quote.commodity->symbol() << ": " << buf);
+
+      // A script that prints something other than a price has failed
+      // like one that prints nothing, and the others are still read.
+      amount_t price;
+      try {
+	price.parse(buf);
+      }
+      catch (const std::exception& err) {
+	DEBUG("quotes.download", "Could not parse quote for "
+	      << quote.commodity->symbol() << ": " << err.what());
+	success = false;
+      }
+      if (success)
+	record_price(*quote.commodity, now, price);
+      else
+	failed.push_back(quote.commodity);
+    } else {
+      failed.push_back(quote.commodity);
+    }
   }
 
-  if (success && buf[0]) {
-    char * p = strchr(buf, '\n');
-    if (p) *p = '\0';
+  INFO_FINISH(quotes);
 
-    DEBUG_("downloaded quote: " << buf);
+  if (! failed.empty())
+    throw_(std::runtime_error,
+	   _("Failed to download price for '%1' (command: \"%2 %1\")")
+	   << failed.front()->symbol() << command);
+}
 
-    price.parse(buf);
-    commodity.add_price(current_moment, price);
+void quotes_by_script::record_price(commodity_t&      commodity,
+				    const datetime_t& now,
+				    const amount_t&   price)
+{
+  commodity.add_price(now, price);
 
-    commodity.history->last_lookup = current_moment;
+  if (optional<commodity_t::history_t&> history =
+      commodity.varied_history()->history(price.commodity()))
+    history->last_lookup = now;
 
-    if (price && ! price_db.empty()) {
-#if defined(__GNUG__) && __GNUG__ < 3
-      ofstream database(price_db.c_str(), ios::out | ios::app);
-#else
-      ofstream database(price_db.c_str(), ios_base::out | ios_base::app);
-#endif
-      database << "P " << current_moment.to_string("%Y/%m/%d %H:%M:%S")
-	       << " " << commodity.symbol << " " << price << endl;
-    }
-  } else {
-    throw_(std::runtime_error,
-	   _("Failed to download price for '%1' (command: \"getquote %1\")")
-	   << commodity.symbol);
+  if (shared_ptr<price_store_t> store = commodity.parent().price_store) {
+    store->append(commodity, now, price);
+  }
+  else if (price_db) {
+    ofstream database(*price_db, std::ios_base::out | std::ios_base::app);
+    database << "P " << format_date(now.date(), string("%Y/%m/%d")) << ' '
+	     << posix_time::to_simple_string(now.time_of_day()).substr(0, 8)
+	     << ' ' << commodity.symbol() << ' ' << price.to_fullstring()
+	     << std::endl;
   }
 }
-#endif
 
 } // namespace ledger
@@ -39,46 +39,79 @@
  *
  * @ingroup extra
  *
- * @brief Brief
+ * @brief Downloading the current prices of commodities.
  *
- * Long.
+ * With --download (-Q), current prices are fetched for the commodities
+ * held in the journal before the report begins, by running a script
+ * (getquote, unless --getquote says otherwise) once for each commodity
+ * and reading a price from its output.  A commodity is not fetched
+ * again within --leeway of its last price.
  */
 #ifndef _QUOTES_H
 #define _QUOTES_H
 
+#include "amount.h"
+#include "commodity.h"
 
 namespace ledger {
 
-#if 0
+class journal_t;
+
 /**
- * @brief Brief
+ * @brief Fetches quotes for many commodities at once
  *
- * Long.
+ * The scripts are run concurrently, no more than `jobs' at a time, and
+ * their prices are read in the order they were started.  Each price is
+ * added to its commodity's history, and recorded in the price store if
+ * there is one, or else appended to the price database.
  */
-class quotes_by_script : public noncopyable, public commodity_t::base_t::updater_t
+class quotes_by_script : public noncopyable
 {
-  string      price_db;
-  std::size_t pricing_leeway;
+  string	   command;
+  long		   leeway;
+  optional<path>   price_db;
+  std::size_t	   jobs;
 
   quotes_by_script();
 
 public:
-  quotes_by_script(path	       _price_db,
-		   std::size_t _pricing_leeway)
-    : price_db(_price_db), pricing_leeway(_pricing_leeway) {
-    TRACE_CTOR(quotes_by_script, "path, std::size_t, bool&");
+  quotes_by_script(const string&	 _command,
+		   const long		 _leeway,
+		   const optional<path>& _price_db,
+		   const std::size_t	 _jobs = 8)
+    : command(_command), leeway(_leeway), price_db(_price_db),
+      jobs(_jobs) {
+    TRACE_CTOR(quotes_by_script, "const string&, long, optional<path>, ...");
   }
   ~quotes_by_script() throw() {
     TRACE_DTOR(quotes_by_script);
   }
 
-  virtual void operator()(commodity_base_t& commodity,
-			  const datetime_t& moment,
-			  const datetime_t& date,
-			  const datetime_t& last,
-			  amount_t&	    price);
+  /**
+   * The commodities held in `journal' whose last price, or last lookup,
+   * is older than the leeway as of `now'.  Commodities which are
+   * themselves used to price others, or are marked as having no market
+   * value, are never quoted.
+   */
+  std::vector<commodity_t *> needing_quotes(journal_t&	      journal,
+					    const datetime_t& now) const;
+
+  /**
+   * Fetch a quote for each of `commodities'.
+   */
+  void download(const std::vector<commodity_t *>& commodities,
+		const datetime_t&		  now);
+
+  void operator()(journal_t& journal) {
+    datetime_t now = CURRENT_TIME();
+    download(needing_quotes(journal, now), now);
+  }
+
+private:
+  void record_price(commodity_t&      commodity,
+		    const datetime_t& now,
+		    const amount_t&   price);
 };
-#endif
 
 } // namespace ledger
 
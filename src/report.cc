@@ -43,6 +43,7 @@
 #include "generate.h"
 #include "derive.h"
 #include "emacs.h"
+#include "pricedb.h"
 
 namespace ledger {
 
@@ -102,24 +103,44 @@ void report_t::commodities_report(post_handler_ptr handler)
   session.clean_posts();
 }
 
+value_t report_t::memoized(memo_slot_t slot, expr_t& expr,
+			   call_scope_t& scope)
+{
+  // Only evaluations made beneath the scope of the item being output may
+  // share its remembered values.
+  if (memo_scope && scope.size() == 0) {
+    scope_t * ptr = &scope;
+    while (ptr && ptr != memo_scope) {
+      child_scope_t * child = dynamic_cast<child_scope_t *>(ptr);
+      ptr = child ? child->parent : NULL;
+    }
+    if (ptr) {
+      if (! memo_values[slot])
+	memo_values[slot] = expr.calc(scope);
+      return *memo_values[slot];
+    }
+  }
+  return expr.calc(scope);
+}
+
 value_t report_t::fn_amount_expr(call_scope_t& scope)
 {
-  return HANDLER(amount_).expr.calc(scope);
+  return memoized(MEMO_AMOUNT_EXPR, HANDLER(amount_).expr, scope);
 }
 
 value_t report_t::fn_total_expr(call_scope_t& scope)
 {
-  return HANDLER(total_).expr.calc(scope);
+  return memoized(MEMO_TOTAL_EXPR, HANDLER(total_).expr, scope);
 }
 
 value_t report_t::fn_display_amount(call_scope_t& scope)
 {
-  return HANDLER(display_amount_).expr.calc(scope);
+  return memoized(MEMO_DISPLAY_AMOUNT, HANDLER(display_amount_).expr, scope);
 }
 
 value_t report_t::fn_display_total(call_scope_t& scope)
 {
-  return HANDLER(display_total_).expr.calc(scope);
+  return memoized(MEMO_DISPLAY_TOTAL, HANDLER(display_total_).expr, scope);
 }
 
 value_t report_t::fn_market(call_scope_t& scope)
@@ -390,8 +411,32 @@ namespace {
 
 value_t report_t::reload_command(call_scope_t&)
 {
-  session.close_journal_files();
-  session.read_journal_files();
+  // A journal that has only been added to, as it usually is between one
+  // command and the next, need not be read again from the start.  If the
+  // new text fails to parse, some of it may already be in the journal,
+  // so it is read again from the start to report the errors afresh.
+  bool current = false;
+  try {
+    current = session.read_appended_journal_files();
+  }
+  catch (const std::exception&) {}
+  catch (int) {}
+
+  if (! current) {
+    session.close_journal_files();
+    session.read_journal_files();
+  }
+  return true;
+}
+
+value_t report_t::pricestore_command(call_scope_t&)
+{
+  if (! session.HANDLED(price_store_))
+    throw_(std::runtime_error,
+	   _("The pricestore command requires a --price-store file"));
+
+  price_store_t(resolve_path(session.HANDLER(price_store_).str()))
+    .print(output_stream);
   return true;
 }
 
@@ -715,6 +760,8 @@ expr_t::ptr_op_t report_t::lookup(const string& name)
 	    (reporter<post_t, post_handler_ptr, &report_t::commodities_report>
 	     (new format_posts(*this, report_format(HANDLER(pricesdb_format_))),
 	      *this));
+	else if (is_eq(q, "pricestore"))
+	  return MAKE_FUNCTOR(report_t::pricestore_command);
 	else if (is_eq(q, "python") && maybe_import("ledger.interp"))
 	  return session.lookup(string(CMD_PREFIX) + "python");
 	break;
@@ -121,8 +121,22 @@ public:
 
   uint_least8_t budget_flags;
 
+  // While a single item is being output, the values of the report's own
+  // expressions are kept here, since a format usually refers to each of
+  // them several times per line.  See item_memo_t below.
+  enum memo_slot_t {
+    MEMO_AMOUNT_EXPR,
+    MEMO_TOTAL_EXPR,
+    MEMO_DISPLAY_AMOUNT,
+    MEMO_DISPLAY_TOTAL,
+    MEMO_SLOTS
+  };
+
+  scope_t *	    memo_scope;
+  optional<value_t> memo_values[MEMO_SLOTS];
+
   explicit report_t(session_t& _session)
-    : session(_session), budget_flags(BUDGET_NO_BUDGET) {}
+    : session(_session), budget_flags(BUDGET_NO_BUDGET), memo_scope(NULL) {}
 
   virtual ~report_t() {
     output_stream.close();
@@ -134,6 +148,8 @@ public:
   void accounts_report(acct_handler_ptr handler);
   void commodities_report(post_handler_ptr handler);
 
+  value_t memoized(memo_slot_t slot, expr_t& expr, call_scope_t& scope);
+
   value_t fn_amount_expr(call_scope_t& scope);
   value_t fn_total_expr(call_scope_t& scope);
   value_t fn_display_amount(call_scope_t& scope);
@@ -165,6 +181,7 @@ public:
   }
 
   value_t reload_command(call_scope_t&);
+  value_t pricestore_command(call_scope_t&);
 
   keep_details_t what_to_keep() {
     bool lots = HANDLED(lots) || HANDLED(lots_actual);
@@ -687,6 +704,36 @@ public:
 	   DO_(args) { value = args[0].to_long(); specified = true; });
 };
 
+/**
+ * @brief Remember report expressions while one item is output
+ *
+ * Within the lifetime of this object, amount_expr, total_expr,
+ * display_amount and display_total are each computed at most once for
+ * evaluations made beneath the given scope.  Nothing may change the
+ * item's totals in the meantime.
+ */
+class item_memo_t : public noncopyable
+{
+  report_t&	    report;
+  scope_t *	    prev_scope;
+  optional<value_t> prev_values[report_t::MEMO_SLOTS];
+
+public:
+  item_memo_t(report_t& _report, scope_t& scope)
+    : report(_report), prev_scope(report.memo_scope) {
+    for (int i = 0; i < report_t::MEMO_SLOTS; i++) {
+      prev_values[i] = report.memo_values[i];
+      report.memo_values[i] = none;
+    }
+    report.memo_scope = &scope;
+  }
+  ~item_memo_t() {
+    for (int i = 0; i < report_t::MEMO_SLOTS; i++)
+      report.memo_values[i] = prev_values[i];
+    report.memo_scope = prev_scope;
+  }
+};
+
 } // namespace ledger
 
 #endif // _REPORT_H
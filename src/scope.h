@@ -50,6 +50,8 @@
 
 namespace ledger {
 
+class dispatch_table_t;
+
 /**
  * @brief Brief
  *
@@ -67,8 +69,60 @@ public:
 
   virtual void define(const string&, expr_t::ptr_op_t) {}
   virtual expr_t::ptr_op_t lookup(const string& name) = 0;
+
+  /**
+   * Look up an interned name.  Scopes that return a dispatch table
+   * have each name looked up at most once, after which it is found in
+   * that table; other scopes simply call lookup().
+   */
+  virtual expr_t::ptr_op_t resolve(const symbol_id_t id);
+
+  /**
+   * A scope whose lookup() gives the same answers for every object of
+   * its class may return a table shared by that class, and any class
+   * deriving from it which overrides lookup() must then return its own
+   * table.
+   */
+  virtual dispatch_table_t * dispatch_table() {
+    return NULL;
+  }
 };
 
+/**
+ * @brief Definitions already found for a class of scope, by symbol id
+ */
+class dispatch_table_t : public noncopyable
+{
+  std::vector<expr_t::ptr_op_t> defs;
+  std::vector<bool>		known;
+
+public:
+  dispatch_table_t() {
+    TRACE_CTOR(dispatch_table_t, "");
+  }
+  ~dispatch_table_t() {
+    TRACE_DTOR(dispatch_table_t);
+  }
+
+  expr_t::ptr_op_t find(scope_t& scope, const symbol_id_t id) {
+    if (id >= known.size()) {
+      defs.resize(id + 1);
+      known.resize(id + 1, false);
+    }
+    if (! known[id]) {
+      defs[id]	= scope.lookup(symbol_name(id));
+      known[id] = true;
+    }
+    return defs[id];
+  }
+};
+
+inline expr_t::ptr_op_t scope_t::resolve(const symbol_id_t id) {
+  if (dispatch_table_t * table = dispatch_table())
+    return table->find(*this, id);
+  return lookup(symbol_name(id));
+}
+
 /**
  * @brief Brief
  *
@@ -148,6 +202,12 @@ public:
     TRACE_DTOR(call_scope_t);
   }
 
+  virtual expr_t::ptr_op_t resolve(const symbol_id_t id) {
+    if (parent)
+      return parent->resolve(id);
+    return NULL;
+  }
+
   void set_args(const value_t& _args) {
     args = _args;
   }
@@ -215,6 +275,13 @@ public:
       return def;
     return child_scope_t::lookup(name);
   }
+  virtual expr_t::ptr_op_t resolve(const symbol_id_t id) {
+    if (expr_t::ptr_op_t def = grandchild.resolve(id))
+      return def;
+    if (parent)
+      return parent->resolve(id);
+    return NULL;
+  }
 };
 
 /**
@@ -38,6 +38,10 @@
 #include "journal.h"
 #include "iterators.h"
 #include "filters.h"
+#include "mapped.h"
+#include "archive.h"
+#include "pricedb.h"
+#include "quotes.h"
 
 namespace ledger {
 
@@ -106,8 +110,17 @@ std::size_t session_t::read_journal(const path& pathname,
   if (! exists(pathname))
     throw_(std::logic_error, _("Cannot read file '%1'") << pathname);
 
-  ifstream stream(pathname);
-  return read_journal(stream, pathname, master);
+  if (! master)
+    master = journal->master;
+
+  std::size_t count = journal->parse(pathname, *this, master,
+				     HANDLED(strict));
+
+  // remove calculated totals and flags
+  clean_posts();
+  clean_accounts();
+
+  return count;
 }
 
 std::size_t session_t::read_data(const string& master_account)
@@ -121,38 +134,113 @@ std::size_t session_t::read_data(const string& master_account)
   if (! master_account.empty())
     acct = journal->find_account(master_account);
 
-  if (HANDLED(price_db_)) {
-    path price_db_path = resolve_path(HANDLER(price_db_).str());
-    if (exists(price_db_path) && read_journal(price_db_path) > 0)
-	throw_(parse_error, _("Transactions not allowed in price history file"));
+  optional<path> price_db_path;
+  if (HANDLED(price_db_))
+    price_db_path = resolve_path(HANDLER(price_db_).str());
+
+  // Given a price store, the text price database is only read in order to
+  // import it into the store, once each time it changes.  The store itself
+  // is attached to the commodities once the journal has been read.
+  optional<path> price_store_path;
+  if (HANDLED(price_store_)) {
+    price_store_path = resolve_path(HANDLER(price_store_).str());
+    if (price_db_path && exists(*price_db_path) &&
+	(! exists(*price_store_path) ||
+	 last_write_time(*price_db_path) > last_write_time(*price_store_path)))
+      price_store_t(*price_store_path).import(*price_db_path);
+    price_db_path = none;
   }
 
-  foreach (const path& pathname, HANDLER(file_).data_files) {
-    path filename = resolve_path(pathname);
-    if (filename == "-") {
-      // To avoid problems with stdin and pipes, etc., we read the entire
-      // file in beforehand into a memory buffer, and then parcel it out
-      // from there.
-      std::ostringstream buffer;
-
-      while (std::cin.good() && ! std::cin.eof()) {
-	char line[8192];
-	std::cin.read(line, 8192);
-	std::streamsize count = std::cin.gcount();
-	buffer.write(line, count);
-      }
-      buffer.flush();
-
-      std::istringstream buf_in(buffer.str());
+  // Only what is read from here on is to be cached; the init file is read
+  // anew on every run regardless.  Its directives (D, for one) can change
+  // how the data files are parsed, though, so the files read so far are
+  // part of the cache key.
+  std::ostringstream init_files;
+  foreach (const journal_t::fileinfo_t& info, journal->sources)
+    init_files << info.filename << ' ' << info.size << ' '
+	       << info.modtime << '\n';
+  journal->sources.clear();
+  journal->cacheable = true;
+
+  // A cached journal cannot say which accounts would have drawn warnings
+  // under --strict, nor be read into some account other than the master,
+  // so in either case the files are always parsed.
+  scoped_ptr<archive_t> cache;
+  if (HANDLED(cache_) && ! HANDLED(no_cache) &&
+      master_account.empty() && ! HANDLED(strict)) {
+    std::ostringstream key;
+    key << current_year << '\n' << init_files.str();
+    if (price_db_path && exists(*price_db_path))
+      key << *price_db_path << '\n';
+    foreach (const path& pathname, HANDLER(file_).data_files)
+      key << resolve_path(pathname) << '\n';
+
+    cache.reset(new archive_t(resolve_path(HANDLER(cache_).str()),
+			      key.str()));
+  }
 
-      xact_count += read_journal(buf_in, "/dev/stdin", acct);
+  if (cache && cache->load(*journal.get())) {
+    xact_count = journal->xacts.size();
+  } else {
+    if (price_db_path) {
+      if (exists(*price_db_path) && read_journal(*price_db_path) > 0)
+	throw_(parse_error,
+	       _("Transactions not allowed in price history file"));
     }
-    else if (exists(filename)) {
-      xact_count += read_journal(filename, acct);
+
+    // The files must be parsed one after another, in the order given, since
+    // they all share one journal, account tree and commodity pool.  But the
+    // reading of them need not wait: start it now for every file, so that
+    // later files are already in memory by the time they are parsed.
+    foreach (const path& pathname, HANDLER(file_).data_files) {
+      path filename = resolve_path(pathname);
+      if (filename != "-" && exists(filename))
+	prefetch_file(filename);
     }
-    else {
-      throw_(parse_error, _("Could not read journal file '%1'") << filename);
+
+    foreach (const path& pathname, HANDLER(file_).data_files) {
+      path filename = resolve_path(pathname);
+      if (filename == "-") {
+	// To avoid problems with stdin and pipes, etc., we read the entire
+	// file in beforehand into a memory buffer, and then parcel it out
+	// from there.
+	std::ostringstream buffer;
+
+	while (std::cin.good() && ! std::cin.eof()) {
+	  char line[8192];
+	  std::cin.read(line, 8192);
+	  std::streamsize count = std::cin.gcount();
+	  buffer.write(line, count);
+	}
+	buffer.flush();
+
+	std::istringstream buf_in(buffer.str());
+
+	xact_count += read_journal(buf_in, "/dev/stdin", acct);
+      }
+      else if (exists(filename)) {
+	xact_count += read_journal(filename, acct);
+      }
+      else {
+	throw_(parse_error, _("Could not read journal file '%1'") << filename);
+      }
     }
+
+    if (cache && cache->should_save(*journal.get()))
+      cache->save(*journal.get());
+  }
+
+  if (price_store_path) {
+    commodity_pool->price_store.reset(new price_store_t(*price_store_path));
+    commodity_pool->price_store->load(*commodity_pool);
+  }
+
+  // Current prices are fetched now, all together, rather than one at a
+  // time as the report happens to value each commodity.
+  if (HANDLED(download)) {
+    quotes_by_script quotes(HANDLER(getquote_).str(),
+			    HANDLER(leeway_).value.to_long(), price_db_path);
+    quotes(*journal);
   }
 
   VERIFY(journal->valid());
@@ -178,6 +266,48 @@ void session_t::read_journal_files()
   INFO("Found " << count << " transactions");
 }
 
+bool session_t::read_appended_journal_files()
+{
+  if (! journal->cacheable || HANDLER(file_).data_files.empty())
+    return false;
+
+  // Only the last file named may have grown, since only what is appended
+  // to it comes after everything else already read; text appended to any
+  // earlier file would have to be placed before that.
+  path last_file = resolve_path(HANDLER(file_).data_files.back());
+
+  journal_t::fileinfo_t * last = NULL;
+  foreach (journal_t::fileinfo_t& info, journal->sources)
+    if (info.filename == last_file)
+      last = &info;
+  if (! last)
+    return false;
+
+  foreach (const journal_t::fileinfo_t& info, journal->sources)
+    if (&info != last && info.changed())
+      return false;
+
+  if (! last->changed())
+    return true;
+
+  account_t * acct = journal->master;
+  if (HANDLED(account_))
+    acct = journal->find_account(HANDLER(account_).str());
+
+  std::size_t count = journal->xacts.size();
+  if (! journal->parse_appended(*last, *this, acct, HANDLED(strict)))
+    return false;
+
+  // remove calculated totals and flags
+  clean_posts();
+  clean_accounts();
+
+  VERIFY(journal->valid());
+
+  INFO("Found " << (journal->xacts.size() - count) << " new transactions");
+  return true;
+}
+
 void session_t::close_journal_files()
 {
   journal.reset();
@@ -216,20 +346,30 @@ option_t<session_t> * session_t::lookup_option(const char * p)
   case 'a':
     OPT_(account_); // -a
     break;
+  case 'c':
+    OPT(cache_);
+    break;
   case 'd':
     OPT(download); // -Q
     break;
   case 'f':
     OPT_(file_); // -f
     break;
+  case 'g':
+    OPT(getquote_);
+    break;
   case 'i':
     OPT(input_date_format_);
     break;
   case 'l':
     OPT(leeway_);
     break;
+  case 'n':
+    OPT(no_cache);
+    break;
   case 'p':
     OPT(price_db_);
+    else OPT(price_store_);
     break;
   case 's':
     OPT(strict);
@@ -93,6 +93,11 @@ public:
   void read_journal_files();
   void close_journal_files();
 
+  // Bring the journal up to date by parsing only what has been appended
+  // to the last journal file since it was read.  Returns false if the
+  // files have changed in any other way, and must be read again in full.
+  bool read_appended_journal_files();
+
   void clean_posts();
   void clean_posts(xact_t& xact);
   void clean_accounts();
@@ -117,8 +122,13 @@ public:
    */
 
   OPTION(session_t, account_); // -a
+  OPTION(session_t, cache_);
   OPTION(session_t, download); // -Q
 
+  OPTION__(session_t, getquote_, CTOR(session_t, getquote_) {
+      on("getquote");
+    });
+
   OPTION__
   (session_t, leeway_,
    CTOR(session_t, leeway_) { value = 24L * 3600L; }
@@ -140,7 +150,9 @@ public:
    });
 
   OPTION(session_t, input_date_format_);
+  OPTION(session_t, no_cache);
   OPTION(session_t, price_db_);
+  OPTION(session_t, price_store_);
   OPTION(session_t, strict);
 };
 
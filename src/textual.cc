@@ -37,6 +37,7 @@
 #include "account.h"
 #include "option.h"
 #include "pstream.h"
+#include "mapped.h"
 
 #define TIMELOG_SUPPORT 1
 #if defined(TIMELOG_SUPPORT)
@@ -58,7 +59,16 @@ namespace {
 #endif
 
     instance_t *      parent;
-    std::istream&     in;
+    std::istream *    in;
+
+    // When parsing a mapped file, lines are read directly out of the
+    // mapping rather than through `in'.
+    char *	      map_base;
+    char *	      map_pos;
+    char *	      map_end;
+    scoped_array<char> last_line;
+    std::size_t       last_line_pos;
+
     scope_t&	      session_scope;
     journal_t&	      journal;
     account_t *	      master;
@@ -82,7 +92,8 @@ namespace {
 #if defined(TIMELOG_SUPPORT)
 	       time_log_t&             _timelog,
 #endif
-	       std::istream&	       _in,
+	       std::istream *	       _in,
+	       mapped_file_t *	       _mapped,
 	       scope_t&	               _session_scope,
 	       journal_t&	       _journal,
 	       account_t *	       _master        = NULL,
@@ -94,9 +105,20 @@ namespace {
 
     void parse();
     std::streamsize read_line(char *& line);
+    std::streamsize read_mapped_line(char *& line);
+    string original_line(const char * line, std::streamsize len);
+    bool at_eof() {
+      if (map_base)
+	return map_pos >= map_end;
+      else
+	return ! in->good() || in->eof();
+    }
     bool peek_whitespace_line() {
-      return (in.good() && ! in.eof() &&
-	      (in.peek() == ' ' || in.peek() == '\t'));
+      if (map_base)
+	return map_pos < map_end && (*map_pos == ' ' || *map_pos == '\t');
+      else
+	return (in->good() && ! in->eof() &&
+		(in->peek() == ' ' || in->peek() == '\t'));
     }
     void read_next_directive(); 
 
@@ -181,7 +203,8 @@ instance_t::instance_t(std::list<account_t *>& _account_stack,
 #if defined(TIMELOG_SUPPORT)
 		       time_log_t&             _timelog,
 #endif
-		       std::istream&	       _in,
+		       std::istream *	       _in,
+		       mapped_file_t *	       _mapped,
 		       scope_t&	               _session_scope,
 		       journal_t&	       _journal,
 		       account_t *	       _master,
@@ -192,9 +215,13 @@ instance_t::instance_t(std::list<account_t *>& _account_stack,
 #if defined(TIMELOG_SUPPORT)
     timelog(_timelog),
 #endif
-    parent(_parent), in(_in), session_scope(_session_scope),
+    parent(_parent), in(_in),
+    map_base(_mapped ? _mapped->begin() : NULL),
+    map_pos(map_base), map_end(_mapped ? _mapped->end() : NULL),
+    last_line_pos(0), session_scope(_session_scope),
     journal(_journal), master(_master),
-    original_file(_original_file), strict(_strict)
+    original_file(_original_file), current_year(-1), strict(_strict),
+    linenum(0)
 {
   TRACE_CTOR(instance_t, "...");
 
@@ -225,15 +252,14 @@ void instance_t::parse()
   TRACE_START(instance_parse, 1,
 	      "Done parsing file '" << pathname.string() << "'");
 
-  if (! in.good() || in.eof())
+  if (at_eof())
     return;
 
-  linenum  = 0;
   errors   = 0;
   count	   = 0;
-  curr_pos = in.tellg();
+  curr_pos = map_base ? istream_pos_type(map_pos - map_base) : in->tellg();
 
-  while (in.good() && ! in.eof()) {
+  while (! at_eof()) {
     try {
       read_next_directive();
     }
@@ -276,15 +302,17 @@ void instance_t::parse()
 
 std::streamsize instance_t::read_line(char *& line)
 {
-  assert(in.good());
-  assert(! in.eof());		// no one should call us in that case
+  assert(! at_eof());		// no one should call us in that case
 
   line_beg_pos = curr_pos;
 
   check_for_signal();
 
-  in.getline(linebuf, MAX_LINE);
-  std::streamsize len = in.gcount();
+  if (map_base)
+    return read_mapped_line(line);
+
+  in->getline(linebuf, MAX_LINE);
+  std::streamsize len = in->gcount();
 
   if (len > 0) {
     if (linenum == 0 && utf8::is_bom(linebuf))
@@ -305,6 +333,62 @@ std::streamsize instance_t::read_line(char *& line)
   return 0;
 }
 
+std::streamsize instance_t::read_mapped_line(char *& line)
+{
+  char *      beg = map_pos;
+  std::size_t len;
+
+  if (char * eol = static_cast<char *>
+      (std::memchr(map_pos, '\n', static_cast<std::size_t>(map_end - map_pos)))) {
+    *eol    = '\0';		// terminate the line in place
+    len	    = static_cast<std::size_t>(eol - map_pos);
+    map_pos = eol + 1;
+  } else {
+    // The final line has no newline after it, and so no byte which can
+    // be overwritten by a terminator.  Copy just this line aside.
+    len	    = static_cast<std::size_t>(map_end - map_pos);
+    last_line.reset(new char[len + 1]);
+    std::memcpy(last_line.get(), map_pos, len);
+    last_line[static_cast<std::ptrdiff_t>(len)] = '\0';
+    last_line_pos = static_cast<std::size_t>(map_pos - map_base);
+    beg	    = last_line.get();
+    map_pos = map_end;
+  }
+
+  curr_pos = static_cast<std::streamoff>(map_pos - map_base);
+
+  if (linenum == 0 && len >= 3 && utf8::is_bom(beg)) {
+    beg += 3;
+    len -= 3;
+  }
+  if (len > 0 && beg[len - 1] == '\r') // strip Windows CRLF down to LF
+    beg[--len] = '\0';
+
+  linenum++;
+
+  line = beg;
+  return static_cast<std::streamsize>(len);
+}
+
+string instance_t::original_line(const char * line, std::streamsize len)
+{
+  // Mapped lines are modified in place as they are parsed, so read an
+  // unaltered copy back from the file itself.
+  std::size_t offset;
+  if (line >= map_base && line < map_end)
+    offset = static_cast<std::size_t>(line - map_base);
+  else
+    offset = last_line_pos + static_cast<std::size_t>(line - last_line.get());
+
+  scoped_array<char> buf(new char[static_cast<std::size_t>(len) + 1]);
+  ifstream stream(pathname);
+  stream.seekg(static_cast<std::streamoff>(offset), std::ios::beg);
+  stream.read(buf.get(), len);
+  buf[static_cast<std::ptrdiff_t>(stream.gcount())] = '\0';
+
+  return buf.get();
+}
+
 void instance_t::read_next_directive()
 {
   char * line;
@@ -411,7 +495,10 @@ void instance_t::clock_in_directive(char * line,
 {
   string datetime(line, 2, 19);
 
-  char * p = skip_ws(line + 22);
+  // Lines are terminated in place, so never look past the end of this
+  // one for an account name which isn't there.
+  char * e = line + std::strlen(line);
+  char * p = line + 22 < e ? skip_ws(line + 22) : e;
   char * n = next_element(p, true);
 
   timelog.clock_in(parse_datetime(datetime, current_year),
@@ -423,11 +510,12 @@ void instance_t::clock_out_directive(char * line,
 {  
   string datetime(line, 2, 19);
 
-  char * p = skip_ws(line + 22);
+  char * e = line + std::strlen(line);
+  char * p = line + 22 < e ? skip_ws(line + 22) : e;
   char * n = next_element(p, true);
 
   timelog.clock_out(parse_datetime(datetime, current_year),
-		    p ? account_stack.front()->find_account(p) : NULL, n ? n : "");
+		    *p ? account_stack.front()->find_account(p) : NULL, n ? n : "");
   count++;
 }
 
@@ -455,59 +543,16 @@ void instance_t::price_conversion_directive(char * line)
   }
 }
 
-namespace {
-  void parse_symbol(char *& p, string& symbol)
-  {
-    if (*p == '"') {
-      char * q = std::strchr(p + 1, '"');
-      if (! q)
-	throw parse_error(_("Quoted commodity symbol lacks closing quote"));
-      symbol = string(p + 1, 0, q - p - 1);
-      p = q + 2;
-    } else {
-      char * q = next_element(p);
-      symbol = p;
-      if (q)
-	p = q;
-      else
-	p += symbol.length();
-    }
-    if (symbol.empty())
-      throw parse_error(_("Failed to parse commodity"));
-  }
-}
-
 void instance_t::price_xact_directive(char * line)
 {
-  char * date_field_ptr = skip_ws(line + 1);
-  char * time_field_ptr = next_element(date_field_ptr);
-  if (! time_field_ptr) return;
-  string date_field = date_field_ptr;
-
-  char *     symbol_and_price;
   datetime_t datetime;
-
-  if (std::isdigit(time_field_ptr[0])) {
-    symbol_and_price = next_element(time_field_ptr);
-    if (! symbol_and_price) return;
-    datetime = parse_datetime(date_field + " " + time_field_ptr,
-			      current_year);
-  } else {
-    symbol_and_price = time_field_ptr;
-    datetime = parse_datetime(date_field, current_year);
-  }
-
-  string symbol;
-  parse_symbol(symbol_and_price, symbol);
-  amount_t price(symbol_and_price);
-  VERIFY(price.valid());
+  amount_t   price;
 
   if (commodity_t * commodity =
-      amount_t::current_pool->find_or_create(symbol)) {
+      amount_t::current_pool->parse_price_directive(line + 1, datetime, price,
+						    current_year)) {
     commodity->add_price(datetime, price, true);
     commodity->add_flags(COMMODITY_KNOWN);
-  } else {
-    assert(false);
   }
 }
 
@@ -515,7 +560,7 @@ void instance_t::nomarket_directive(char * line)
 {
   char * p = skip_ws(line + 1);
   string symbol;
-  parse_symbol(p, symbol);
+  commodity_t::parse_symbol(p, symbol);
 
   if (commodity_t * commodity =
       amount_t::current_pool->find_or_create(symbol))
@@ -536,6 +581,8 @@ void instance_t::option_directive(char * line)
       *p++ = '\0';
   }
   process_option(line + 2, session_scope, p, line);
+
+  journal.cacheable = false;
 }
 
 void instance_t::automated_xact_directive(char * line)
@@ -664,13 +711,19 @@ void instance_t::include_directive(char * line)
   DEBUG("textual.include", "Line " << linenum << ": " <<
 	"Including path '" << filename << "'");
 
-  ifstream stream(filename);
+  journal.record_source(filename);
+
+  mapped_file_t   mapped;
+  scoped_ptr<ifstream> stream;
+  if (! mapped.open(filename))
+    stream.reset(new ifstream(filename));
 
   instance_t instance(account_stack, tag_stack,
 #if defined(TIMELOG_SUPPORT)
 		      timelog,
 #endif
-		      stream, session_scope, journal, master,
+		      stream.get(), mapped.is_open() ? &mapped : NULL,
+		      session_scope, journal, master,
 		      &filename, strict, this);
   instance.parse();
 
@@ -736,6 +789,8 @@ void instance_t::define_directive(char * line)
 {
   expr_t def(skip_ws(line));
   def.compile(session_scope);	// causes definitions to be established
+
+  journal.cacheable = false;
 }
 
 void instance_t::general_directive(char * line)
@@ -803,6 +858,8 @@ void instance_t::general_directive(char * line)
     call_scope_t args(*this);
     args.push_back(string_value(p));
     op->as_function()(args);
+
+    journal.cacheable = false;
   }
 }
 
@@ -821,8 +878,11 @@ post_t * instance_t::parse_post(char *		line,
   post->beg_pos  = line_beg_pos;
   post->beg_line = linenum;
 
+  // Mapped lines can be any length, and since the original text is
+  // still on disk it is only fetched again if an error must be shown.
   char buf[MAX_LINE + 1];
-  std::strcpy(buf, line);
+  if (! map_base)
+    std::strcpy(buf, line);
   std::size_t beg = 0;
 
   try {
@@ -1104,7 +1164,9 @@ post_t * instance_t::parse_post(char *		line,
   }
   catch (const std::exception& err) {
     add_error_context(_("While parsing posting:"));
-    add_error_context(line_context(buf, beg, len));
+    add_error_context(line_context(map_base ?
+				   original_line(line, len) : string(buf),
+				   beg, len));
     throw;
   }
 }
@@ -1277,42 +1339,231 @@ expr_t::ptr_op_t instance_t::lookup(const string& name)
   return session_scope.lookup(name);
 }
 
+namespace {
+  std::size_t parse_journal(journal_t&	    journal,
+			    std::istream *  in,
+			    mapped_file_t * mapped,
+			    scope_t&	    session_scope,
+			    account_t *	    master,
+			    const path *    original_file,
+			    bool	    strict,
+			    journal_t::fileinfo_t * info = NULL,
+			    std::size_t	    start    = 0,
+			    std::size_t	    linenum  = 0)
+  {
+    TRACE_START(parsing_total, 1, "Total time spent parsing text:");
+
+    std::list<account_t *> account_stack;
+    std::list<string>      tag_stack;
+#if defined(TIMELOG_SUPPORT)
+    time_log_t		   timelog(journal);
+#endif
+
+    instance_t parsing_instance(account_stack, tag_stack,
+#if defined(TIMELOG_SUPPORT)
+				timelog,
+#endif
+				in, mapped, session_scope, journal, master,
+				original_file, strict);
+
+    // When resuming the parse of a file that has been appended to, begin
+    // after the text already read, with automated transactions applied if
+    // they were being applied when that text ran out.
+    if (mapped)
+      parsing_instance.map_pos += start;
+    parsing_instance.linenum = linenum;
+
+    if (info && info->auto_xacts) {
+      parsing_instance.auto_xact_finalizer.reset
+	(new auto_xact_finalizer_t(&journal));
+      journal.add_xact_finalizer(parsing_instance.auto_xact_finalizer.get());
+    }
+
+    parsing_instance.parse();
+
+    // A file whose text had errors is never taken to have been read up
+    // to some point, from which its appended text could be parsed.
+    if (info && parsing_instance.errors == 0) {
+      info->appendable = (account_stack.size() == 1 && tag_stack.empty() &&
+			  parsing_instance.account_aliases.empty() &&
+			  parsing_instance.current_year == -1);
+      info->auto_xacts = parsing_instance.auto_xact_finalizer.get() != NULL;
+    }
+
+    TRACE_STOP(parsing_total, 1);
+
+    // These tracers were started in textual.cc
+    TRACE_FINISH(xact_text, 1);
+    TRACE_FINISH(xact_details, 1);
+    TRACE_FINISH(xact_posts, 1);
+    TRACE_FINISH(xacts, 1);
+    TRACE_FINISH(instance_parse, 1); // report per-instance timers
+    TRACE_FINISH(parsing_total, 1);
+
+    if (parsing_instance.errors > 0)
+      throw static_cast<int>(parsing_instance.errors);
+
+    return parsing_instance.count;
+  }
+}
+
+namespace {
+  // Read the first `size' bytes of a stream, giving their checksum, the
+  // number of lines they end and the last of them.  Returns false if the
+  // stream holds fewer.
+  bool checksum_stream(std::istream&	in,
+		       std::size_t	size,
+		       uint_least32_t&	checksum,
+		       std::size_t&	lines,
+		       char&		last)
+  {
+    char buf[8192];
+
+    checksum = text_checksum(buf, buf); // that of no bytes at all
+    lines    = 0;
+    last     = '\n';
+
+    while (size > 0) {
+      in.read(buf, static_cast<std::streamsize>(std::min(size, sizeof(buf))));
+      std::size_t len = static_cast<std::size_t>(in.gcount());
+      if (len == 0)
+	return false;
+      checksum = text_checksum(buf, buf + len, checksum);
+      lines   += static_cast<std::size_t>(std::count(buf, buf + len, '\n'));
+      last     = buf[len - 1];
+      size    -= len;
+    }
+    return true;
+  }
+}
+
 std::size_t journal_t::parse(std::istream& in,
 			     scope_t&      session_scope,
 			     account_t *   master,
 			     const path *  original_file,
 			     bool          strict)
 {
-  TRACE_START(parsing_total, 1, "Total time spent parsing text:");
+  // There is no file behind a stream whose identity could be recorded.
+  cacheable = false;
 
-  std::list<account_t *> account_stack;
-  std::list<string>      tag_stack;
-#if defined(TIMELOG_SUPPORT)
-  time_log_t		 timelog(*this);
-#endif
+  return parse_journal(*this, &in, NULL, session_scope, master,
+		       original_file, strict);
+}
 
-  instance_t parsing_instance(account_stack, tag_stack,
-#if defined(TIMELOG_SUPPORT)
-			      timelog,
-#endif
-			      in, session_scope, *this, master,
-			      original_file, strict);
-  parsing_instance.parse();
+std::size_t journal_t::parse(const path& pathname,
+			     scope_t&    session_scope,
+			     account_t * master,
+			     bool        strict)
+{
+  // Regular files are mapped into memory and parsed in place; anything
+  // else (a pipe, a device, or a platform without mmap) is read through
+  // an ordinary stream.
+  fileinfo_t * info = record_source(pathname);
+
+  mapped_file_t mapped;
+  if (mapped.open(pathname)) {
+    // The text is summed before it is parsed, since parsing writes over
+    // the end of each line.
+    uint_least32_t checksum = text_checksum(mapped.begin(), mapped.end());
+
+    std::size_t count = parse_journal(*this, NULL, &mapped, session_scope,
+				      master, &pathname, strict, info);
+    if (info) {
+      info->size     = mapped.length();
+      info->checksum = checksum;
+    }
+    return count;
+  }
+
+  std::size_t count;
+  {
+    ifstream stream(pathname);
+    count = parse_journal(*this, &stream, NULL, session_scope, master,
+			  &pathname, strict, info);
+  }
+  if (info) {
+    ifstream	stream(pathname);
+    std::size_t lines;
+    char	last;
+    if (! checksum_stream(stream, static_cast<std::size_t>(info->size),
+			  info->checksum, lines, last))
+      info->appendable = false;
+  }
+  return count;
+}
 
-  TRACE_STOP(parsing_total, 1);
+bool journal_t::parse_appended(fileinfo_t& info,
+			       scope_t&	   session_scope,
+			       account_t * master,
+			       bool	   strict)
+{
+  if (! info.appendable || ! is_regular_file(info.filename) ||
+      file_size(info.filename) <= info.size)
+    return false;
+
+  // If the last item read from the file no longer ends within the text
+  // read before, the file was rewritten rather than appended to.
+  for (xacts_list::reverse_iterator i = xacts.rbegin();
+       i != xacts.rend();
+       i++) {
+    if ((*i)->pathname == info.filename) {
+      if (static_cast<uintmax_t>((*i)->end_pos) > info.size)
+	return false;
+      break;
+    }
+  }
 
-  // These tracers were started in textual.cc
-  TRACE_FINISH(xact_text, 1);
-  TRACE_FINISH(xact_details, 1);
-  TRACE_FINISH(xact_posts, 1);
-  TRACE_FINISH(xacts, 1);
-  TRACE_FINISH(instance_parse, 1); // report per-instance timers
-  TRACE_FINISH(parsing_total, 1);
+  // The text already read must be just as it was, and have ended with a
+  // complete line, or the first of the new lines would only be the rest
+  // of it.  The record of the file is brought up to date only once the
+  // new text has been parsed without error.
+  std::size_t start   = static_cast<std::size_t>(info.size);
+  std::size_t linenum = 0;
+
+  mapped_file_t mapped;
+  if (mapped.open(info.filename)) {
+    if (mapped.length() < start ||
+	(start > 0 && mapped.begin()[start - 1] != '\n') ||
+	text_checksum(mapped.begin(), mapped.begin() + start) != info.checksum)
+      return false;
+    linenum = static_cast<std::size_t>
+      (std::count(mapped.begin(), mapped.begin() + start, '\n'));
+
+    uint_least32_t checksum = text_checksum(mapped.begin() + start,
+					    mapped.end(), info.checksum);
+
+    parse_journal(*this, NULL, &mapped, session_scope, master,
+		  &info.filename, strict, &info, start, linenum);
+
+    info.size	  = mapped.length();
+    info.modtime  = last_write_time(info.filename);
+    info.checksum = checksum;
+    return true;
+  }
 
-  if (parsing_instance.errors > 0)
-    throw static_cast<int>(parsing_instance.errors);
+  uint_least32_t checksum;
+  char		 last;
+  {
+    ifstream stream(info.filename);
+    if (! checksum_stream(stream, start, checksum, linenum, last) ||
+	last != '\n' || checksum != info.checksum)
+      return false;
+
+    parse_journal(*this, &stream, NULL, session_scope, master,
+		  &info.filename, strict, &info, 0, linenum);
+  }
 
-  return parsing_instance.count;
+  ifstream    stream(info.filename);
+  std::size_t size = static_cast<std::size_t>(file_size(info.filename));
+  std::size_t lines;
+  if (! checksum_stream(stream, size, checksum, lines, last)) {
+    info.appendable = false;
+  } else {
+    info.size	  = size;
+    info.modtime  = last_write_time(info.filename);
+    info.checksum = checksum;
+  }
+  return true;
 }
 
 } // namespace ledger
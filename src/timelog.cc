@@ -113,6 +113,10 @@ time_log_t::~time_log_t()
   TRACE_DTOR(time_log_t);
 
   if (! time_xacts.empty()) {
+    // Entries still clocked in are closed out as of now, which a cached
+    // copy of the journal would wrongly leave fixed at this moment.
+    journal.cacheable = false;
+
     std::list<account_t *> accounts;
 
     foreach (time_xact_t& time_xact, time_xacts)
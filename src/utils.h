@@ -554,6 +554,17 @@ inline char peek_next_nonws(std::istream& in) {
   return c;
 }
 
+// FNV-1a, over the bytes in [data, end).  Passing the checksum of the
+// bytes before `data' as `hash' gives the checksum of them all.
+inline uint_least32_t text_checksum(const char * data, const char * end,
+				    uint_least32_t hash = 2166136261UL) {
+  for (; data < end; data++) {
+    hash ^= static_cast<unsigned char>(*data);
+    hash = static_cast<uint_least32_t>(hash * 16777619UL);
+  }
+  return hash;
+}
+
 #define READ_INTO(str, targ, size, var, cond) {		\
     char * _p = targ;					\
     var = static_cast<char>(str.peek());		\
@@ -37,9 +37,6 @@
 
 namespace ledger {
 
-intrusive_ptr<value_t::storage_t> value_t::true_value;
-intrusive_ptr<value_t::storage_t> value_t::false_value;
-
 value_t::storage_t& value_t::storage_t::operator=(const value_t::storage_t& rhs)
 {
   type = rhs.type;
@@ -62,19 +59,12 @@ value_t::storage_t& value_t::storage_t::operator=(const value_t::storage_t& rhs)
 
 void value_t::initialize()
 {
-  true_value	    = new storage_t;
-  true_value->type  = BOOLEAN;
-  true_value->data  = true;
-
-  false_value	    = new storage_t;
-  false_value->type = BOOLEAN;
-  false_value->data = false;
+  // Booleans used to share a pair of static storage objects; they are
+  // now held inline, so there is nothing left to set up here.
 }
 
 void value_t::shutdown()
 {
-  true_value  = intrusive_ptr<storage_t>();
-  false_value = intrusive_ptr<storage_t>();
 }
 
 value_t::operator bool() const
@@ -123,6 +113,15 @@ value_t::operator bool() const
 
 void value_t::set_type(type_t new_type)
 {
+  // Inline types are set by assigning to inline_data and then calling
+  // set_inline_type, so that the data assigned may still refer into the
+  // storage object being given up.
+  assert(! is_inline(new_type));
+
+  if (inline_type == AMOUNT)
+    inline_data = false;	// release the amount's quantity
+  inline_type = VOID;
+
   if (new_type == VOID) {
 #if BOOST_VERSION >= 103700
     storage.reset();
@@ -125,12 +125,7 @@ private:
      * The `type' member holds the value_t::type_t value representing
      * the type of the object stored.
      */
-    variant<bool,	  // BOOLEAN
-	    datetime_t,	  // DATETIME
-	    date_t,	  // DATE
-	    long,	  // INTEGER
-	    amount_t,	  // AMOUNT
-	    balance_t *,  // BALANCE
+    variant<balance_t *,  // BALANCE
 	    string,	  // STRING
 	    mask_t,	  // MASK
 	    sequence_t *, // SEQUENCE
@@ -225,11 +220,46 @@ private:
   };
 
   /**
-   * The actual data for each value_t is kept in reference counted storage.
+   * Booleans, dates, integers and amounts are small enough to be kept
+   * within the value_t itself, so that the temporaries made while
+   * evaluating expressions need not allocate anything.  `inline_type'
+   * gives the type held by `inline_data', or VOID if the value is null
+   * or its data is kept in `storage'.
+   */
+  type_t inline_type;
+
+  variant<bool,		// BOOLEAN
+	  datetime_t,	// DATETIME
+	  date_t,	// DATE
+	  long,		// INTEGER
+	  amount_t	// AMOUNT
+	  > inline_data;
+
+  /**
+   * The data for all other types is kept in reference counted storage.
    * Data is modified using a copy-on-write policy.
    */
   intrusive_ptr<storage_t> storage;
 
+  static bool is_inline(const type_t the_type) {
+    return the_type >= BOOLEAN && the_type <= AMOUNT;
+  }
+
+  /**
+   * Mark the value as holding the inline data of the given type, which
+   * has just been assigned, and let go of any storage object.
+   */
+  void set_inline_type(type_t new_type) {
+    inline_type = new_type;
+    if (storage) {
+#if BOOST_VERSION >= 103700
+      storage.reset();
+#else
+      storage = intrusive_ptr<storage_t>();
+#endif
+    }
+  }
+
   /**
    * Make a private copy of the current value (if necessary) so it can
    * subsequently be modified.
@@ -240,14 +270,6 @@ private:
       storage = new storage_t(*storage.get());
   }
 
-  /**
-   * Because boolean "true" and "false" are so common, a pair of static
-   * references are kept to prevent the creation of throwaway storage_t
-   * objects just to represent these two common values.
-   */
-  static intrusive_ptr<storage_t> true_value;
-  static intrusive_ptr<storage_t> false_value;
-
 public:
   static void initialize();
   static void shutdown();
@@ -266,57 +288,57 @@ public:
    * true) is required to represent the literal string "$100", and not
    * the amount "one hundred dollars".
    */
-  value_t() {
+  value_t() : inline_type(VOID) {
     TRACE_CTOR(value_t, "");
   }
 
-  value_t(const bool val) {
+  value_t(const bool val) : inline_type(VOID) {
     TRACE_CTOR(value_t, "const bool");
     set_boolean(val);
   }
 
-  value_t(const datetime_t& val) {
+  value_t(const datetime_t& val) : inline_type(VOID) {
     TRACE_CTOR(value_t, "const datetime_t&");
     set_datetime(val);
   }
-  value_t(const date_t& val) {
+  value_t(const date_t& val) : inline_type(VOID) {
     TRACE_CTOR(value_t, "const date_t&");
     set_date(val);
   }
 
-  value_t(const long val) {
+  value_t(const long val) : inline_type(VOID) {
     TRACE_CTOR(value_t, "const long");
     set_long(val);
   }
-  value_t(const unsigned long val) {
+  value_t(const unsigned long val) : inline_type(VOID) {
     TRACE_CTOR(value_t, "const unsigned long");
     set_amount(val);
   }
-  value_t(const double val) {
+  value_t(const double val) : inline_type(VOID) {
     TRACE_CTOR(value_t, "const double");
     set_amount(val);
   }
-  value_t(const amount_t& val) {
+  value_t(const amount_t& val) : inline_type(VOID) {
     TRACE_CTOR(value_t, "const amount_t&");
     set_amount(val);
   }
-  value_t(const balance_t& val) {
+  value_t(const balance_t& val) : inline_type(VOID) {
     TRACE_CTOR(value_t, "const balance_t&");
     set_balance(val);
   }
-  value_t(const mask_t& val) {
+  value_t(const mask_t& val) : inline_type(VOID) {
     TRACE_CTOR(value_t, "const mask_t&");
     set_mask(val);
   }
 
-  explicit value_t(const string& val, bool literal = false) {
+  explicit value_t(const string& val, bool literal = false) : inline_type(VOID) {
     TRACE_CTOR(value_t, "const string&, bool");
     if (literal)
       set_string(val);
     else
       set_amount(amount_t(val));
   }
-  explicit value_t(const char * val, bool literal = false) {
+  explicit value_t(const char * val, bool literal = false) : inline_type(VOID) {
     TRACE_CTOR(value_t, "const char *");
     if (literal)
       set_string(val);
@@ -324,13 +346,13 @@ public:
       set_amount(amount_t(val));
   }
 
-  value_t(const sequence_t& val) {
+  value_t(const sequence_t& val) : inline_type(VOID) {
     TRACE_CTOR(value_t, "const sequence_t&");
     set_sequence(val);
   }
 
   template <typename T>
-  explicit value_t(T * item) {
+  explicit value_t(T * item) : inline_type(VOID) {
     TRACE_CTOR(value_t, "T *");
     set_pointer(item);
   }
@@ -346,16 +368,26 @@ public:
 
   /**
    * Assignment and copy operators.  Values are cheaply copied by
-   * simply creating another reference to the other value's storage
-   * object.  A true copy is only ever made prior to modification.
+   * copying their inline data, or else by creating another reference
+   * to the other value's storage object.  A true copy of storage is
+   * only ever made prior to modification.
    */
-  value_t(const value_t& val) {
+  value_t(const value_t& val)
+    : inline_type(val.inline_type), inline_data(val.inline_data),
+      storage(val.storage) {
     TRACE_CTOR(value_t, "copy");
-    *this = val;
   }
   value_t& operator=(const value_t& val) {
-    if (! (this == &val || storage == val.storage))
-      storage = val.storage;
+    if (this != &val) {
+      if (val.inline_type != VOID)
+	inline_data = val.inline_data;
+      else if (inline_type == AMOUNT)
+	inline_data = false;
+      inline_type = val.inline_type;
+
+      if (storage != val.storage)
+	storage = val.storage;
+    }
     return *this;
   }
 
@@ -461,7 +493,7 @@ public:
   bool is_realzero() const;
   bool is_zero() const;
   bool is_null() const {
-    if (! storage) {
+    if (! storage && inline_type == VOID) {
       VERIFY(is_type(VOID));
       return true;
     } else {
@@ -471,7 +503,7 @@ public:
   }
 
   type_t type() const {
-    return storage ? storage->type : VOID;
+    return storage ? storage->type : inline_type;
   }
   bool is_type(type_t _type) const {
     return type() == _type;
@@ -515,16 +547,15 @@ public:
   }
   bool& as_boolean_lval() {
     VERIFY(is_boolean());
-    _dup();
-    return boost::get<bool>(storage->data);
+    return boost::get<bool>(inline_data);
   }
   const bool& as_boolean() const {
     VERIFY(is_boolean());
-    return boost::get<bool>(storage->data);
+    return boost::get<bool>(inline_data);
   }
   void set_boolean(const bool val) {
-    set_type(BOOLEAN);
-    storage = val ? true_value : false_value;
+    inline_data = val;
+    set_inline_type(BOOLEAN);
   }
 
   bool is_datetime() const {
@@ -532,16 +563,15 @@ public:
   }
   datetime_t& as_datetime_lval() {
     VERIFY(is_datetime());
-    _dup();
-    return boost::get<datetime_t>(storage->data);
+    return boost::get<datetime_t>(inline_data);
   }
   const datetime_t& as_datetime() const {
     VERIFY(is_datetime());
-    return boost::get<datetime_t>(storage->data);
+    return boost::get<datetime_t>(inline_data);
   }
   void set_datetime(const datetime_t& val) {
-    set_type(DATETIME);
-    storage->data = val;
+    inline_data = val;
+    set_inline_type(DATETIME);
   }
 
   bool is_date() const {
@@ -549,16 +579,15 @@ public:
   }
   date_t& as_date_lval() {
     VERIFY(is_date());
-    _dup();
-    return boost::get<date_t>(storage->data);
+    return boost::get<date_t>(inline_data);
   }
   const date_t& as_date() const {
     VERIFY(is_date());
-    return boost::get<date_t>(storage->data);
+    return boost::get<date_t>(inline_data);
   }
   void set_date(const date_t& val) {
-    set_type(DATE);
-    storage->data = val;
+    inline_data = val;
+    set_inline_type(DATE);
   }
 
   bool is_long() const {
@@ -566,16 +595,15 @@ public:
   }
   long& as_long_lval() {
     VERIFY(is_long());
-    _dup();
-    return boost::get<long>(storage->data);
+    return boost::get<long>(inline_data);
   }
   const long& as_long() const {
     VERIFY(is_long());
-    return boost::get<long>(storage->data);
+    return boost::get<long>(inline_data);
   }
   void set_long(const long val) {
-    set_type(INTEGER);
-    storage->data = val;
+    inline_data = val;
+    set_inline_type(INTEGER);
   }
 
   bool is_amount() const {
@@ -583,17 +611,16 @@ public:
   }
   amount_t& as_amount_lval() {
     VERIFY(is_amount());
-    _dup();
-    return boost::get<amount_t>(storage->data);
+    return boost::get<amount_t>(inline_data);
   }
   const amount_t& as_amount() const {
     VERIFY(is_amount());
-    return boost::get<amount_t>(storage->data);
+    return boost::get<amount_t>(inline_data);
   }
   void set_amount(const amount_t& val) {
     VERIFY(val.valid());
-    set_type(AMOUNT);
-    storage->data = val;
+    inline_data = val;
+    set_inline_type(AMOUNT);
   }
 
   bool is_balance() const {
@@ -819,11 +846,7 @@ public:
     VERIFY(! is_null());
 
     if (! is_sequence()) {
-#if BOOST_VERSION >= 103700
-      storage.reset();
-#else
-      storage = intrusive_ptr<storage_t>();
-#endif
+      set_type(VOID);
     } else {
       as_sequence_lval().pop_back();
 
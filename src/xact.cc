@@ -344,6 +344,35 @@ xact_t::xact_t(const xact_t& e)
   TRACE_CTOR(xact_t, "copy");
 }
 
+namespace {
+  struct xact_pool_tag {};
+
+  typedef boost::singleton_pool<xact_pool_tag, sizeof(xact_t),
+				boost::default_user_allocator_new_delete,
+				boost::details::pool::null_mutex> xact_pool;
+}
+
+void * xact_t::operator new(std::size_t size)
+{
+  // A class derived from xact_t is bigger than the pool's blocks.
+  if (size != sizeof(xact_t))
+    return ::operator new(size);
+
+  if (void * ptr = xact_pool::malloc())
+    return ptr;
+  throw std::bad_alloc();
+}
+
+void xact_t::operator delete(void * ptr, std::size_t size)
+{
+  if (! ptr)
+    return;
+  if (size != sizeof(xact_t))
+    ::operator delete(ptr);
+  else
+    xact_pool::free(ptr);
+}
+
 void xact_t::add_post(post_t * post)
 {
   post->xact = this;
@@ -385,6 +414,12 @@ expr_t::ptr_op_t xact_t::lookup(const string& name)
   return item_t::lookup(name);
 }
 
+dispatch_table_t * xact_t::dispatch_table()
+{
+  static dispatch_table_t table;
+  return &table;
+}
+
 bool xact_t::valid() const
 {
   if (! _date || ! journal) {
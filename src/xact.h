@@ -91,7 +91,7 @@ class xact_t : public xact_base_t
 {
 public:
   optional<string> code;
-  string	   payee;
+  interned_t	   payee;
 
   xact_t() {
     TRACE_CTOR(xact_t, "");
@@ -102,9 +102,14 @@ public:
     TRACE_DTOR(xact_t);
   }
 
+  // Like postings, transactions are allocated from a pool of their own.
+  static void * operator new(std::size_t size);
+  static void	operator delete(void * ptr, std::size_t size);
+
   virtual void add_post(post_t * post);
 
   virtual expr_t::ptr_op_t lookup(const string& name);
+  virtual dispatch_table_t * dispatch_table();
 
   virtual bool valid() const;
 };
@@ -1324,4 +1324,71 @@ void AmountTestCase::testCommodityPrinting()
   assertValid(x2);
 }
 
+void AmountTestCase::testSerialization()
+{
+  amount_t x0;
+  amount_t x1(internalAmount("$-982340823.386238098235098235098235098"));
+  amount_t x2("123.456");
+  amount_t x3(0L);
+
+  std::ostringstream out;
+  x0.write_quantity(out);
+  x1.write_quantity(out);
+  x2.write_quantity(out);
+  x3.write_quantity(out);
+
+  std::string  buf(out.str());
+  const char * data = buf.data();
+  const char * end  = buf.data() + buf.length();
+
+  amount_t y0, y1, y2, y3;
+  y0.read_quantity(data, end);
+  y1.read_quantity(data, end);
+  y1.set_commodity(x1.commodity());
+  y2.read_quantity(data, end);
+  y3.read_quantity(data, end);
+
+  assertTrue(data == end);
+
+  assertTrue(y0.is_null());
+  assertEqual(x1, y1);
+  assertEqual(x1.to_fullstring(), y1.to_fullstring());
+  assertEqual(x2, y2);
+  assertEqual(x2.to_fullstring(), y2.to_fullstring());
+  assertEqual(x3, y3);
+
+  assertValid(y0);
+  assertValid(y1);
+  assertValid(y2);
+  assertValid(y3);
+}
+
+void AmountTestCase::testFixedPointOverflow()
+{
+  amount_t x1("999999999999999999");
+  amount_t x2("0.000000000000000001");
+  amount_t x3(x1 * amount_t(10L));
+  amount_t x4("-5.25");
+
+  assertEqual(amount_t("9999999999999999990"), x3);
+  assertEqual(amount_t("-9999999999999999990"), x3.negated());
+  assertTrue(x3 > x1);
+  assertTrue(x1 < x3);
+
+  x1 += x2;
+  assertEqual(amount_t("999999999999999999.000000000000000001"), x1);
+  x1 -= x2;
+  assertEqual(amount_t("999999999999999999"), x1);
+
+  x4 -= amount_t("5.255");
+  assertEqual(amount_t("-10.505"), x4);
+  assertEqual(-1, x4.sign());
+  assertEqual(string("-10.505"), x4.to_string());
+
+  assertValid(x1);
+  assertValid(x2);
+  assertValid(x3);
+  assertValid(x4);
+}
+
 #endif // NOT_FOR_PYTHON
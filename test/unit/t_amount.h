@@ -46,6 +46,8 @@ class AmountTestCase : public CPPUNIT_NS::TestCase
   CPPUNIT_TEST(testCommodityConversion);
   CPPUNIT_TEST(testPrinting);
   CPPUNIT_TEST(testCommodityPrinting);
+  CPPUNIT_TEST(testSerialization);
+  CPPUNIT_TEST(testFixedPointOverflow);
 
   CPPUNIT_TEST_SUITE_END();
 
@@ -96,6 +98,8 @@ public:
   void testCommodityConversion();
   void testPrinting();
   void testCommodityPrinting();
+  void testSerialization();
+  void testFixedPointOverflow();
 
 private:
   AmountTestCase(const AmountTestCase &copy);
@@ -0,0 +1,120 @@
+#include <system.hh>
+
+#include "t_archive.h"
+
+#include "archive.h"
+#include "journal.h"
+#include "xact.h"
+#include "post.h"
+#include "account.h"
+#include "commodity.h"
+
+using namespace ledger;
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(ArchiveTestCase, "data");
+
+void ArchiveTestCase::setUp() {
+  amount_t::initialize();
+  amount_t::stream_fullstrings = true;
+}
+
+void ArchiveTestCase::tearDown() {
+  amount_t::shutdown();
+}
+
+namespace {
+  void write_journal(const path& file, const string& key)
+  {
+    account_t master;
+    journal_t journal(&master);
+
+    xact_t * xact = new xact_t;
+    xact->_date = parse_date("2009/01/01");
+    xact->payee = "Purchase";
+    xact->add_post(new post_t(journal.find_account("Assets:Brokerage"),
+			      amount_t("10 AAPL")));
+    xact->add_post(new post_t(journal.find_account("Assets:Checking"),
+			      amount_t("$-50.00")));
+    assertTrue(journal.add_xact(xact));
+
+    commodity_t * aapl = amount_t::current_pool->find("AAPL");
+    assertTrue(aapl);
+    aapl->add_price(parse_datetime("2009/02/01 00:00:00"),
+		    amount_t("$6.00"));
+
+    archive_t(file, key).save(journal);
+  }
+}
+
+void ArchiveTestCase::testRoundTrip()
+{
+  path file("t_archive.cache");
+  write_journal(file, "key");
+
+  // Start again from an empty commodity pool, so that everything below
+  // can only have come from the cache.
+  amount_t::shutdown();
+  amount_t::initialize();
+
+  account_t master;
+  journal_t journal(&master);
+
+  assertFalse(archive_t(file, "other key").load(journal));
+  assertTrue(journal.xacts.empty());
+
+  assertTrue(archive_t(file, "key").load(journal));
+  assertEqual(std::size_t(1), journal.xacts.size());
+
+  xact_t * xact = journal.xacts.front();
+  assertEqual(string("Purchase"), xact->payee.str());
+  assertEqual(parse_date("2009/01/01"), xact->date());
+  assertEqual(std::size_t(2), xact->posts.size());
+
+  account_t * brokerage = journal.find_account("Assets:Brokerage", false);
+  account_t * checking	= journal.find_account("Assets:Checking", false);
+  assertTrue(brokerage);
+  assertTrue(checking);
+  assertEqual(std::size_t(1), brokerage->posts.size());
+  assertEqual(amount_t("10 AAPL"), brokerage->posts.front()->amount);
+  assertEqual(amount_t("$-50.00"), checking->posts.front()->amount);
+
+  commodity_t * aapl	= amount_t::current_pool->find("AAPL");
+  commodity_t * dollars = amount_t::current_pool->find("$");
+  assertTrue(aapl);
+  assertTrue(dollars);
+
+  optional<price_point_t> point =
+    aapl->find_price(*dollars, parse_datetime("2009/03/01 00:00:00"));
+  assertTrue(point);
+  assertEqual(amount_t("$6.00"), point->price);
+
+  boost::filesystem::remove(file);
+}
+
+void ArchiveTestCase::testDamagedCache()
+{
+  path file("t_archive.cache");
+  write_journal(file, "key");
+
+  // Cut the cache short in the middle of its body; it must then be
+  // ignored without anything having been read from it.
+  string data;
+  {
+    ifstream in(file, std::ios::binary);
+    data.assign(std::istreambuf_iterator<char>(in),
+		std::istreambuf_iterator<char>());
+  }
+  {
+    ofstream out(file, std::ios::binary | std::ios::trunc);
+    out.write(data.data(), static_cast<std::streamsize>(data.length() - 8));
+  }
+
+  account_t master;
+  journal_t journal(&master);
+
+  assertFalse(archive_t(file, "key").load(journal));
+  assertTrue(journal.xacts.empty());
+  assertTrue(master.accounts.empty());
+
+  boost::filesystem::remove(file);
+}
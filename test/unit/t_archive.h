@@ -0,0 +1,30 @@
+#ifndef _T_ARCHIVE_H
+#define _T_ARCHIVE_H
+
+#include "UnitTests.h"
+
+class ArchiveTestCase : public CPPUNIT_NS::TestCase
+{
+  CPPUNIT_TEST_SUITE(ArchiveTestCase);
+
+  CPPUNIT_TEST(testRoundTrip);
+  CPPUNIT_TEST(testDamagedCache);
+
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  ArchiveTestCase() {}
+  virtual ~ArchiveTestCase() {}
+
+  virtual void setUp();
+  virtual void tearDown();
+
+  void testRoundTrip();
+  void testDamagedCache();
+
+private:
+  ArchiveTestCase(const ArchiveTestCase &copy);
+  void operator=(const ArchiveTestCase &copy);
+};
+
+#endif // _T_ARCHIVE_H
@@ -4,6 +4,7 @@
 
 #include "utils.h"
 #include "amount.h"
+#include "balance.h"
 
 using namespace ledger;
 
@@ -25,3 +26,36 @@ void BalanceTestCase::tearDown()
   amount_t::stream_fullstrings = false;
   amount_t::shutdown();
 }
+
+void BalanceTestCase::testManyCommodities()
+{
+  const char * symbols[] = { "AAA", "BBB", "CCC", "DDD", "EEE", "FFF", "GGG" };
+  const std::size_t count = sizeof(symbols) / sizeof(symbols[0]);
+
+  balance_t b1;
+  for (std::size_t i = 0; i < count; i++)
+    b1 += amount_t(string("10 ") + symbols[i]);
+
+  assertEqual(count, b1.commodity_count());
+  assertEqual(amount_t("10 DDD"),
+	      *b1.commodity_amount(amount_t("1 DDD").commodity()));
+
+  balance_t::amounts_map::const_iterator i = b1.amounts.begin();
+  for (balance_t::amounts_map::const_iterator j = i + 1; j != b1.amounts.end(); i++, j++)
+    assertTrue(std::less<const commodity_t *>()(i->first, j->first));
+
+  balance_t b2(b1);
+  assertTrue(b1 == b2);
+
+  b2 -= amount_t("10 AAA");
+  b2 -= amount_t("10 GGG");
+  assertEqual(count - 2, b2.commodity_count());
+  assertFalse(b2.commodity_amount(amount_t("1 AAA").commodity()));
+  assertFalse(b1 == b2);
+
+  b1 = b2;
+  assertTrue(b1 == b2);
+
+  assertValid(b1);
+  assertValid(b2);
+}
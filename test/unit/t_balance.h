@@ -8,6 +8,7 @@ class BalanceTestCase : public CPPUNIT_NS::TestCase
   CPPUNIT_TEST_SUITE(BalanceTestCase);
 
   //CPPUNIT_TEST(testConstructors);
+  CPPUNIT_TEST(testManyCommodities);
 
   CPPUNIT_TEST_SUITE_END();
 
@@ -19,6 +20,7 @@ public:
   virtual void tearDown();
 
   //void testConstructors();
+  void testManyCommodities();
 
 private:
   BalanceTestCase(const BalanceTestCase &copy);
@@ -4,6 +4,7 @@
 
 #include "amount.h"
 #include "commodity.h"
+#include "pricedb.h"
 
 using namespace ledger;
 
@@ -102,3 +103,135 @@ void CommodityTestCase::testPriceHistory()
 
   assertValid(x1);
 }
+
+void CommodityTestCase::testAnnotatedLookup()
+{
+  commodity_pool_t& pool(*amount_t::current_pool);
+
+  amount_t x1("10 AAPL {$30.00}");
+  amount_t x2("5 AAPL {$30.00}");
+  amount_t x3("10 AAPL {$31.00}");
+  amount_t x4("10 AAPL {$30.00} [2009/01/01]");
+
+  assertTrue(x1.commodity().annotated);
+  assertTrue(&x1.commodity() == &x2.commodity());
+  assertTrue(&x1.commodity() != &x3.commodity());
+  assertTrue(&x1.commodity() != &x4.commodity());
+
+  std::size_t hits = pool.annotated_hits;
+  amount_t x5("1 AAPL {$31.00}");
+  assertTrue(&x3.commodity() == &x5.commodity());
+  assertEqual(hits + 1, pool.annotated_hits);
+
+  assertValid(x1);
+  assertValid(x5);
+}
+
+void CommodityTestCase::testLotPriceTables()
+{
+  commodity_pool_t& pool(*amount_t::current_pool);
+
+  amount_t x1("10 AAPL {$30.00}");
+  amount_t x2("10 AAPL {$31.00}");
+  amount_t one_dollar("$1.00");
+
+  commodity_t& aapl(x1.commodity().referent());
+  commodity_t& dollars(one_dollar.commodity());
+  aapl.add_price(parse_datetime("2009/01/01 00:00:00"), amount_t("$40.00"));
+
+  // Both lots are priced through the one table kept for AAPL.
+  std::size_t tables = pool.price_tables.size();
+  datetime_t  moment = parse_datetime("2009/02/01 00:00:00");
+
+  optional<price_point_t> p1 = x1.commodity().find_price(dollars, moment);
+  optional<price_point_t> p2 = x2.commodity().find_price(dollars, moment);
+  assertTrue(p1);
+  assertTrue(p2);
+  assertEqual(amount_t("$40.00"), p1->price);
+  assertEqual(amount_t("$40.00"), p2->price);
+  assertEqual(tables + 1, pool.price_tables.size());
+
+  assertValid(x1);
+  assertValid(x2);
+}
+
+void CommodityTestCase::testPriceStore()
+{
+  commodity_pool_t& pool(*amount_t::current_pool);
+
+  path text("t_commodity.prices");
+  path store("t_commodity.pricestore");
+  {
+    ofstream out(text);
+    out << "P 2009/01/01 00:00:00 AAPL $10.00\n"
+	<< "P 2009/02/01 00:00:00 AAPL $20.00\n"
+	<< "P 2009/01/15 EUR $1.50\n"
+	<< "N EUR\n";
+  }
+  boost::filesystem::remove(store);
+
+  price_store_t(store).import(text);
+
+  // Importing reads the text without touching the pool.
+  assertFalse(pool.find("AAPL"));
+  assertFalse(pool.find("EUR"));
+  assertFalse(pool.find("$"));
+
+  commodity_t * aapl = pool.find_or_create("AAPL");
+  price_store_t(store).append(*aapl, parse_datetime("2009/03/01"),
+			      amount_t("$30.00"));
+  assertFalse(aapl->varied_history());
+
+  pool.price_store.reset(new price_store_t(store));
+  pool.price_store->load(pool);
+
+  commodity_t * dollars = pool.find("$");
+  commodity_t * euros = pool.find("EUR");
+  assertTrue(dollars);
+  assertTrue(euros);
+  assertTrue(euros->has_flags(COMMODITY_NOMARKET));
+  assertFalse(aapl->has_flags(COMMODITY_NOMARKET));
+
+  // Prices are found in the store, and in the history appended to it.
+  optional<price_point_t> point =
+    aapl->find_price(*dollars, parse_datetime("2009/01/20"));
+  assertTrue(point);
+  assertEqual(amount_t("$10.00"), point->price);
+
+  point = aapl->find_price(*dollars, parse_datetime("2009/02/20"));
+  assertTrue(point);
+  assertEqual(amount_t("$20.00"), point->price);
+
+  point = aapl->find_price(*dollars, parse_datetime("2009/03/20"));
+  assertTrue(point);
+  assertEqual(amount_t("$30.00"), point->price);
+
+  assertFalse(aapl->find_price(*dollars, parse_datetime("2008/12/31")));
+
+  // The commodity a price is given in has the inverse price.
+  point = dollars->find_price(*aapl, parse_datetime("2009/01/20"));
+  assertTrue(point);
+  assertEqual(amount_t("0.1 AAPL"), point->price);
+
+  // The pool's price tables search the store rather than reading it.
+  point = pool.find_price(*aapl, *dollars, parse_datetime("2009/02/20"));
+  assertTrue(point);
+  assertEqual(amount_t("$20.00"), point->price);
+  assertFalse(pool.find_price(*aapl, *dollars, parse_datetime("2008/12/31")));
+
+  assertTrue(pool.prices_between(parse_datetime("2009/01/20"),
+				 parse_datetime("2009/02/20")));
+  assertFalse(pool.prices_between(parse_datetime("2009/02/02"),
+				  parse_datetime("2009/02/20")));
+
+  std::ostringstream out;
+  pool.price_store->print(out);
+  assertEqual(string("N EUR\n"
+		     "P 2009/01/01 00:00:00 AAPL $10.00\n"
+		     "P 2009/02/01 00:00:00 AAPL $20.00\n"
+		     "P 2009/03/01 00:00:00 AAPL $30.00\n"
+		     "P 2009/01/15 00:00:00 EUR $1.50\n"), out.str());
+
+  boost::filesystem::remove(text);
+  boost::filesystem::remove(store);
+}
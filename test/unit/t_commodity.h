@@ -8,6 +8,9 @@ class CommodityTestCase : public CPPUNIT_NS::TestCase
   CPPUNIT_TEST_SUITE(CommodityTestCase);
 
   CPPUNIT_TEST(testPriceHistory);
+  CPPUNIT_TEST(testAnnotatedLookup);
+  CPPUNIT_TEST(testLotPriceTables);
+  CPPUNIT_TEST(testPriceStore);
 
   CPPUNIT_TEST_SUITE_END();
 
@@ -19,6 +22,9 @@ public:
   virtual void tearDown();
 
   void testPriceHistory();
+  void testAnnotatedLookup();
+  void testLotPriceTables();
+  void testPriceStore();
 
 private:
   CommodityTestCase(const CommodityTestCase &copy);
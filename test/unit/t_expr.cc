@@ -3,6 +3,9 @@
 #include "t_expr.h"
 
 #include "expr.h"
+#include "op.h"
+#include "scope.h"
+#include "bytecode.h"
 
 using namespace ledger;
 
@@ -17,3 +20,200 @@ void ValueExprTestCase::tearDown()
 {
   amount_t::shutdown();
 }
+
+namespace {
+  long bumps;
+
+  value_t get_yes(call_scope_t&) {
+    return true;
+  }
+  value_t get_no(call_scope_t&) {
+    return false;
+  }
+  value_t get_n(call_scope_t&) {
+    return 5L;
+  }
+  value_t get_name(call_scope_t&) {
+    return string_value("foo");
+  }
+  value_t get_bump(call_scope_t&) {
+    return ++bumps;
+  }
+  value_t get_sum(call_scope_t& args) {
+    value_t total(0L);
+    for (std::size_t i = 0; i < args.size(); i++)
+      total += args[i];
+    return total;
+  }
+  value_t get_fail(call_scope_t&) {
+    throw_(calc_error, _("Failed on purpose"));
+    return NULL_VALUE;
+  }
+
+  void define_functions(symbol_scope_t& scope)
+  {
+    scope.define("yes",  WRAP_FUNCTOR(get_yes));
+    scope.define("no",   WRAP_FUNCTOR(get_no));
+    scope.define("n",    WRAP_FUNCTOR(get_n));
+    scope.define("name", WRAP_FUNCTOR(get_name));
+    scope.define("bump", WRAP_FUNCTOR(get_bump));
+    scope.define("sum",  WRAP_FUNCTOR(get_sum));
+    scope.define("fail", WRAP_FUNCTOR(get_fail));
+  }
+
+  // Evaluate an expression through the tree and then through its
+  // bytecode, checking that both give the same result and call "bump"
+  // the same number of times.  Returns the result and leaves the number
+  // of calls to "bump" in `bumps'.
+  value_t calc_both(scope_t& scope, const string& text)
+  {
+    expr_t expr(text);
+    expr.compile(scope);
+
+    bumps = 0;
+    value_t by_tree(expr.get_op()->calc(scope));
+    long    tree_bumps = bumps;
+
+    expr_t::bytecode_t code(expr.get_op());
+    bumps = 0;
+    value_t by_code(code.run(scope));
+
+    assertEqual(by_tree, by_code);
+    assertEqual(tree_bumps, bumps);
+
+    // A second run must not see anything left over from the first.
+    bumps = 0;
+    assertEqual(by_code, code.run(scope));
+    assertEqual(tree_bumps, bumps);
+
+    return by_code;
+  }
+}
+
+void ValueExprTestCase::testBytecodeFunctions()
+{
+  symbol_scope_t scope;
+  define_functions(scope);
+
+  assertEqual(string("5"),   calc_both(scope, "n").to_string());
+  assertEqual(string("foo"), calc_both(scope, "name").to_string());
+  assertEqual(string("5"),   calc_both(scope, "n * 2 - n").to_string());
+  assertEqual(string("-5"),  calc_both(scope, "-n").to_string());
+  assertTrue(calc_both(scope, "n == 5").to_boolean());
+  assertTrue(calc_both(scope, "n >= 5").to_boolean());
+  assertFalse(calc_both(scope, "n < 5").to_boolean());
+  assertTrue(calc_both(scope, "!no").to_boolean());
+  assertEqual(1L, calc_both(scope, "bump").to_long());
+}
+
+void ValueExprTestCase::testBytecodeShortCircuit()
+{
+  symbol_scope_t scope;
+  define_functions(scope);
+
+  assertFalse(calc_both(scope, "no & bump").to_boolean());
+  assertEqual(0L, bumps);
+  assertTrue(calc_both(scope, "yes | bump").to_boolean());
+  assertEqual(0L, bumps);
+
+  assertEqual(1L, calc_both(scope, "yes & bump").to_long());
+  assertEqual(1L, bumps);
+  assertEqual(1L, calc_both(scope, "no | bump").to_long());
+  assertEqual(1L, bumps);
+
+  assertFalse(calc_both(scope, "bump & no").to_boolean());
+  assertEqual(1L, bumps);
+  assertFalse(calc_both(scope, "no & bump | no & bump").to_boolean());
+  assertEqual(0L, bumps);
+}
+
+void ValueExprTestCase::testBytecodeQueryColon()
+{
+  symbol_scope_t scope;
+  define_functions(scope);
+
+  assertEqual(string("foo"),
+	      calc_both(scope, "n > 3 ? name : bump").to_string());
+  assertEqual(0L, bumps);
+  assertEqual(string("10"),
+	      calc_both(scope, "n < 3 ? bump : n * 2").to_string());
+  assertEqual(0L, bumps);
+  assertEqual(string("1"),
+	      calc_both(scope, "no ? n : yes ? bump : n").to_string());
+  assertEqual(1L, bumps);
+}
+
+void ValueExprTestCase::testBytecodeArguments()
+{
+  symbol_scope_t scope;
+  define_functions(scope);
+
+  assertEqual(string("5"),  calc_both(scope, "sum(n)").to_string());
+  assertEqual(string("10"), calc_both(scope, "sum(n, 2, 3)").to_string());
+  assertEqual(string("1"),  calc_both(scope, "sum(n + 1, -n)").to_string());
+  assertEqual(string("3"),  calc_both(scope, "sum(bump, bump)").to_string());
+  assertEqual(2L, bumps);
+  assertEqual(string("7"),  calc_both(scope, "sum(sum(n, 2))").to_string());
+}
+
+void ValueExprTestCase::testBytecodeSequences()
+{
+  symbol_scope_t scope;
+  define_functions(scope);
+
+  assertEqual(string("5"), calc_both(scope, "bump; n").to_string());
+  assertEqual(1L, bumps);
+  assertEqual(string("6"), calc_both(scope, "bump; bump; n + 1").to_string());
+  assertEqual(2L, bumps);
+  assertEqual(3L, calc_both(scope, "bump; bump; bump").to_long());
+  assertEqual(3L, bumps);
+}
+
+void ValueExprTestCase::testBytecodeMatch()
+{
+  symbol_scope_t scope;
+  define_functions(scope);
+
+  assertTrue(calc_both(scope, "name =~ /oo/").to_boolean());
+  assertFalse(calc_both(scope, "name =~ /^o/").to_boolean());
+  assertTrue(calc_both(scope, "!(name =~ /x/)").to_boolean());
+  assertTrue(calc_both(scope, "name =~ /f/ & n == 5").to_boolean());
+}
+
+void ValueExprTestCase::testBytecodeErrorLocus()
+{
+  symbol_scope_t scope;
+  define_functions(scope);
+
+  expr_t expr("n + fail");
+  expr.compile(scope);
+
+  expr_t::ptr_op_t	  root(expr.get_op());
+  expr_t::bytecode_t code(root);
+
+  // The failing call is blamed on the identifier which named it, so
+  // that op_context() can point at it.
+  expr_t::ptr_op_t locus;
+  assertThrow(code.run(scope, &locus), calc_error);
+  assertTrue(locus);
+  assertTrue(locus == root->right());
+  assertTrue(locus->is_ident());
+  assertEqual(string("fail"), locus->as_ident());
+  assertTrue(op_context(root, locus).find('^') != string::npos);
+
+  // A locus already set by a deeper evaluation is left alone.
+  expr_t::ptr_op_t deeper(root->left());
+  assertThrow(code.run(scope, &deeper), calc_error);
+  assertTrue(deeper == root->left());
+
+  // With "fail" bound to something that succeeds, both ways agree.
+  symbol_scope_t other;
+  define_functions(other);
+  other.define("fail", WRAP_FUNCTOR(get_n));
+  assertEqual(string("10"), calc_both(other, "n + fail").to_string());
+
+  // Going through expr_t::calc, the locus becomes part of the error
+  // context.
+  expr_t whole("n + fail");
+  assertThrow(whole.calc(scope), calc_error);
+}
@@ -8,6 +8,13 @@ class ValueExprTestCase : public CPPUNIT_NS::TestCase
   CPPUNIT_TEST_SUITE(ValueExprTestCase);
 
   //CPPUNIT_TEST(testConstructors);
+  CPPUNIT_TEST(testBytecodeFunctions);
+  CPPUNIT_TEST(testBytecodeShortCircuit);
+  CPPUNIT_TEST(testBytecodeQueryColon);
+  CPPUNIT_TEST(testBytecodeArguments);
+  CPPUNIT_TEST(testBytecodeSequences);
+  CPPUNIT_TEST(testBytecodeMatch);
+  CPPUNIT_TEST(testBytecodeErrorLocus);
 
   CPPUNIT_TEST_SUITE_END();
 
@@ -19,6 +26,13 @@ public:
   virtual void tearDown();
 
   //void testConstructors();
+  void testBytecodeFunctions();
+  void testBytecodeShortCircuit();
+  void testBytecodeQueryColon();
+  void testBytecodeArguments();
+  void testBytecodeSequences();
+  void testBytecodeMatch();
+  void testBytecodeErrorLocus();
 
 private:
   ValueExprTestCase(const ValueExprTestCase &copy);
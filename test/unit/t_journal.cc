@@ -0,0 +1,125 @@
+#include <system.hh>
+
+#include "t_journal.h"
+
+#include "journal.h"
+#include "xact.h"
+#include "post.h"
+#include "account.h"
+#include "scope.h"
+
+using namespace ledger;
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(JournalTestCase, "data");
+
+void JournalTestCase::setUp() {
+  amount_t::initialize();
+}
+
+void JournalTestCase::tearDown() {
+  amount_t::shutdown();
+}
+
+namespace {
+  const char * first_xact =
+    "2009/01/01 Grocer\n"
+    "    Expenses:Food               $10.00\n"
+    "    Assets:Cash\n";
+
+  const char * second_xact =
+    "\n"
+    "2009/01/02 Bookshop\n"
+    "    Expenses:Books              $15.00\n"
+    "    Assets:Cash\n";
+
+  const char * unbalanced_xact =
+    "\n"
+    "2009/01/03 Baker\n"
+    "    Expenses:Food                $5.00\n"
+    "    Assets:Cash                 $-4.00\n";
+
+  void write_file(const path& file, const string& text, bool append = false)
+  {
+    ofstream out(file, append ? std::ios::app : std::ios::trunc);
+    out << text;
+  }
+}
+
+void JournalTestCase::testParseAppended()
+{
+  path file("t_journal.dat");
+  write_file(file, first_xact);
+
+  symbol_scope_t scope;
+  account_t	 master;
+  journal_t	 journal(&master);
+
+  assertEqual(std::size_t(1), journal.parse(file, scope));
+  journal_t::fileinfo_t& info(journal.sources.back());
+  assertTrue(info.appendable);
+  assertEqual(file_size(file), info.size);
+
+  // With nothing added, there is nothing to parse.
+  assertFalse(journal.parse_appended(info, scope));
+
+  write_file(file, second_xact, true);
+  assertTrue(journal.parse_appended(info, scope));
+  assertEqual(std::size_t(2), journal.xacts.size());
+  assertEqual(string("Bookshop"), journal.xacts.back()->payee.str());
+  assertEqual(file_size(file), info.size);
+  assertEqual(std::size_t(5), journal.xacts.back()->beg_line);
+
+  boost::filesystem::remove(file);
+}
+
+void JournalTestCase::testEditedBeforeAppend()
+{
+  path file("t_journal.dat");
+  write_file(file, first_xact);
+
+  symbol_scope_t scope;
+  account_t	 master;
+  journal_t	 journal(&master);
+
+  assertEqual(std::size_t(1), journal.parse(file, scope));
+  journal_t::fileinfo_t& info(journal.sources.back());
+  uintmax_t size = info.size;
+
+  // Change an amount without changing the length of the text, and add a
+  // transaction after it; the change must not go unnoticed.
+  string edited(first_xact);
+  edited.replace(edited.find("$10.00"), 6, "$20.00");
+  write_file(file, edited + second_xact);
+
+  assertFalse(journal.parse_appended(info, scope));
+  assertEqual(std::size_t(1), journal.xacts.size());
+  assertEqual(size, info.size);
+
+  boost::filesystem::remove(file);
+}
+
+void JournalTestCase::testErrorInAppended()
+{
+  path file("t_journal.dat");
+  write_file(file, first_xact);
+
+  symbol_scope_t scope;
+  account_t	 master;
+  journal_t	 journal(&master);
+
+  assertEqual(std::size_t(1), journal.parse(file, scope));
+  journal_t::fileinfo_t& info(journal.sources.back());
+  uintmax_t	 size	  = info.size;
+  uint_least32_t checksum = info.checksum;
+
+  write_file(file, string(second_xact) + unbalanced_xact, true);
+
+  // The error is thrown, and the file is still known to have been read
+  // only as far as before, so that it is not taken to be up to date.
+  assertThrow(journal.parse_appended(info, scope), int);
+  assertEqual(size, info.size);
+  assertEqual(checksum, info.checksum);
+  assertTrue(info.changed());
+
+  boost::filesystem::remove(file);
+}
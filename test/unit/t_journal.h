@@ -0,0 +1,32 @@
+#ifndef _T_JOURNAL_H
+#define _T_JOURNAL_H
+
+#include "UnitTests.h"
+
+class JournalTestCase : public CPPUNIT_NS::TestCase
+{
+  CPPUNIT_TEST_SUITE(JournalTestCase);
+
+  CPPUNIT_TEST(testParseAppended);
+  CPPUNIT_TEST(testEditedBeforeAppend);
+  CPPUNIT_TEST(testErrorInAppended);
+
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  JournalTestCase() {}
+  virtual ~JournalTestCase() {}
+
+  virtual void setUp();
+  virtual void tearDown();
+
+  void testParseAppended();
+  void testEditedBeforeAppend();
+  void testErrorInAppended();
+
+private:
+  JournalTestCase(const JournalTestCase &copy);
+  void operator=(const JournalTestCase &copy);
+};
+
+#endif // _T_JOURNAL_H
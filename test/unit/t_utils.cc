@@ -2,5 +2,36 @@
 
 #include "t_utils.h"
 
+#include "mask.h"
+
 CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(UtilitiesTestCase, "util");
 
+
+using namespace ledger;
+
+void UtilitiesTestCase::testMaskLiterals()
+{
+  // Plain text masks must match just as the regular expression would
+  const char * patterns[] = {
+    "rent", "^Expenses:Food", "food$", "^Assets:Checking$", "\\$5",
+    "a.b", "exp|inc", "^", "$", "\\<rent", "rent\\>", "\\'", "\\.b",
+    NULL
+  };
+  const char * texts[] = {
+    "", "RENT", "Expenses:Rent", "expenses:food:dining", "Dining Food",
+    "Assets:Checking", "Assets:Checking:Savings", "x\nexpenses:food",
+    "food\n", "$5", "axb", "rental", "current", "a.b", NULL
+  };
+
+  for (const char ** pattern = patterns; *pattern; pattern++) {
+    mask_t mask(*pattern);
+    for (const char ** text = texts; *text; text++)
+      assertEqual(boost::regex_search(string(*text), mask.expr),
+		  mask.match(*text));
+  }
+
+  assertTrue(mask_t("^expenses:food").match("Expenses:Food:Dining"));
+  assertFalse(mask_t("^food").match("Expenses:Food"));
+  assertTrue(mask_t("checking$").match("Assets:Checking"));
+  assertTrue(mask_t("^assets:checking$").match("ASSETS:CHECKING"));
+}
@@ -8,6 +8,7 @@ class UtilitiesTestCase : public CPPUNIT_NS::TestCase
   CPPUNIT_TEST_SUITE(UtilitiesTestCase);
 
   //CPPUNIT_TEST(testConstructors);
+  CPPUNIT_TEST(testMaskLiterals);
 
   CPPUNIT_TEST_SUITE_END();
 
@@ -19,6 +20,7 @@ public:
   //virtual void tearDown();
 
   //void testConstructors();
+  void testMaskLiterals();
 
 private:
   UtilitiesTestCase(const UtilitiesTestCase &copy);